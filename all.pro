@@ -4,4 +4,5 @@ TEMPLATE = subdirs
 
 SUBDIRS = \
     ./app/doublecontact.pro \
-    ./contconv
+    ./contconv \
+    ./tests/dcbroundtrip
@@ -114,4 +114,6 @@ void CompareDialog::getData(ContactItem &left, ContactItem &right)
         pURL->getData(left.url, right.url);
     if (pIMs)
         pIMs->getData(left.ims, right.ims);
+    left.calculateFields();
+    right.calculateFields();
 }
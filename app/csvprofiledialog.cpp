@@ -58,7 +58,8 @@ void CSVProfileDialog::selectProfile(CSVFile *format)
             ui->cbSeparator->currentText());
         if (profile==S_GENERIC_CSV_PROFILE) {
             format->setEncoding(ui->cbEncoding->currentText());
-            format->setSeparator(ui->cbSeparator->currentText());
+            if (!ui->cbSeparator->currentText().isEmpty())
+                format->setSeparator(ui->cbSeparator->currentText().at(0));
         }
     }
 }
@@ -875,8 +875,9 @@ void MainWindow::on_actionReverse_full_name_triggered()
 
 void MainWindow::on_actionS_tatistics_triggered()
 {
+    const ContactList& list = selectedModel->itemList();
     QMessageBox::information(0, tr("Statitics"),
-        selectedModel->itemList().statistics());
+        list.statistics() + "\n\n" + list.memoryReport().toString(list.count()));
 }
 
 void MainWindow::on_actionRe_port_triggered()
@@ -890,7 +891,7 @@ void MainWindow::on_actionRe_port_triggered()
         QStringList errors;
         QString fatalError;
         FormatFactory factory;
-        IFormat* format = factory.createObject(path);
+        IFormat* format = factory.createObject(path, QIODevice::WriteOnly);
         if (!format)
             fatalError = factory.error;
         else {
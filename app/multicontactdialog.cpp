@@ -51,4 +51,5 @@ void MultiContactDialog::getData(ContactItem &item)
         item.organization = ui->leOrganization->text();
     if (ui->edDescription->toPlainText()!=("*"))
         item.description = ui->edDescription->toPlainText();
+    item.calculateFields(ContactItem::fgName);
 }
@@ -13,18 +13,61 @@
 
 #include "QFile"
 #include "QFileInfo"
+#include <QDir>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSet>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
 #include "convertor.h"
 #include "formats/formatfactory.h"
+#include "formats/files/dcbfile.h"
 #include "formats/files/htmlfile.h"
+#include "formats/files/jcardfile.h"
+#include "formats/files/ldiffile.h"
 #include "formats/files/mpbfile.h"
 #include "formats/files/udxfile.h"
+#include "formats/files/vcfarchive.h"
 #include "formats/files/vcfdirectory.h"
 #include "formats/files/vcffile.h"
 
+// Runs one conversion of batch
+class ConvertJob : public QRunnable
+{
+public:
+    ConvertJob(const ConvertOptions& options, const QString& inPath, const QString& outPath)
+        :inPath(inPath), outPath(outPath), exitCode(0), options(options)
+    {
+        setAutoDelete(false);
+    }
+    void run();
+    QString inPath, outPath;
+    QString logText;
+    int exitCode;
+    QSemaphore done; // released when job finished, to report jobs in order
+private:
+    const ConvertOptions& options;
+};
+
+void ConvertJob::run()
+{
+    QTextStream log(&logText);
+    exitCode = Convertor::convert(options, inPath, outPath, log);
+    log.flush();
+    done.release();
+}
+
+ConvertOptions::ConvertOptions()
+    :infoMode(false), forceOverwrite(false), forceSingleFile(false), forceDirectory(false),
+      swapNames(false), splitNames(false), generateFullNames(false), dropFullNames(false),
+      reverseFullNames(false), dropSlashes(false), filterExclusive(false), filterReverse(false)
+{
+}
+
 Convertor::Convertor(int &argc, char **argv)
     : QCoreApplication(argc, argv),
-      out(stdout)
+      out(isStdOutUsed() ? stderr : stdout)
 {
 }
 
@@ -37,19 +80,10 @@ int Convertor::start()
         printUsage();
         return 1;
     }
-    QString inPath, outPath, outFormat, inProfile, outProfile, filterString;
-    bool infoMode = false;
-    bool forceOverwrite = false;
-    bool forceSingleFile = false;
-    bool forceDirectory = false;
-    bool swapNames = false;
-    bool splitNames = false;
-    bool generateFullNames = false;
-    bool dropFullNames = false;
-    bool reverseFullNames = false;
-    bool dropSlashes = false;
-    bool filterExclusive = false;
-    bool filterReverse = false;
+    ConvertOptions opt;
+    QStringList inPaths;
+    QString outPath, batchPath, logDir;
+    int threadCount = QThread::idealThreadCount();
     for (int i=1; i<arguments().count(); i++) {
         if (arguments()[i]=="-i" || arguments()[i]=="--info") {
             i++;
@@ -58,9 +92,9 @@ int Convertor::start()
                 printUsage();
                 return 2;
             }
-            inPath = arguments()[i];
+            inPaths << arguments()[i];
             if (arguments()[i-1]=="--info")
-                    infoMode = true;
+                    opt.infoMode = true;
             continue;
         }
         else if (arguments()[i]=="-o") {
@@ -80,16 +114,34 @@ int Convertor::start()
                 printUsage();
                 return 4;
             }
-            outFormat = arguments()[i];
-            if (outFormat!="vcf21" && outFormat!="vcf30" && outFormat!="vcfauto"
-            && outFormat!="udx" && outFormat!="mpb" && outFormat!="csv" && outFormat!="html"
-            && outFormat!="copy") {
-                out << tr("Error: Unknown output format: %1\n").arg(outFormat);
+            opt.outFormat = arguments()[i];
+            if (opt.outFormat!="vcf21" && opt.outFormat!="vcf30" && opt.outFormat!="vcfauto"
+            && opt.outFormat!="udx" && opt.outFormat!="mpb" && opt.outFormat!="csv" && opt.outFormat!="html"
+            && opt.outFormat!="dcb" && opt.outFormat!="vcfzip" && opt.outFormat!="ldif"
+            && opt.outFormat!="jcard" && opt.outFormat!="copy") {
+                out << tr("Error: Unknown output format: %1\n").arg(opt.outFormat);
                 printUsage();
                 return 5;
             }
             continue;
         }
+        else if (arguments()[i]=="--input-format") {
+            i++;
+            if (i==arguments().count()) {
+                out << tr("Error: --input-format option present, but format name is missing\n");
+                printUsage();
+                return 32;
+            }
+            opt.inFormat = arguments()[i];
+            // Only formats, which can be read sequentially
+            if (opt.inFormat!="vcf" && opt.inFormat!="csv" && opt.inFormat!="udx" && opt.inFormat!="mpb"
+            && opt.inFormat!="dcb" && opt.inFormat!="ldif" && opt.inFormat!="jcard") {
+                out << tr("Error: Unknown input format: %1\n").arg(opt.inFormat);
+                printUsage();
+                return 32;
+            }
+            continue;
+        }
         else if (arguments()[i]=="-ip") {
             i++;
             if (i==arguments().count()) {
@@ -97,9 +149,9 @@ int Convertor::start()
                 printUsage();
                 return 6;
             }
-            inProfile = arguments()[i];
-            if (inProfile!="explaybm50" && inProfile!="explaytv240" && inProfile!="generic") {
-                out << tr("Error: Unknown input profile: %1\n").arg(inProfile);
+            opt.inProfile = arguments()[i];
+            if (!isCSVProfile(opt.inProfile)) {
+                out << tr("Error: Unknown input profile: %1\n").arg(opt.inProfile);
                 printUsage();
                 return 7;
             }
@@ -112,36 +164,68 @@ int Convertor::start()
                 printUsage();
                 return 8;
             }
-            outProfile = arguments()[i];
-            if (outProfile!="explaybm50" && outProfile!="explaytv240" && outProfile!="generic") {
-                out << tr("Error: Unknown output profile: %1\n").arg(outProfile);
+            opt.outProfile = arguments()[i];
+            if (!isCSVProfile(opt.outProfile)) {
+                out << tr("Error: Unknown output profile: %1\n").arg(opt.outProfile);
                 printUsage();
                 return 9;
             }
             continue;
         }
+        else if (arguments()[i]=="--batch") {
+            i++;
+            if (i==arguments().count()) {
+                out << tr("Error: --batch option present, but manifest path is missing\n");
+                printUsage();
+                return 27;
+            }
+            batchPath = arguments()[i];
+            continue;
+        }
+        else if (arguments()[i]=="--threads") {
+            i++;
+            bool ok = false;
+            if (i<arguments().count())
+                threadCount = arguments()[i].toInt(&ok);
+            if (!ok || threadCount<1) {
+                out << tr("Error: --threads option requires positive number\n");
+                printUsage();
+                return 28;
+            }
+            continue;
+        }
+        else if (arguments()[i]=="--log-dir") {
+            i++;
+            if (i==arguments().count()) {
+                out << tr("Error: --log-dir option present, but directory path is missing\n");
+                printUsage();
+                return 29;
+            }
+            logDir = arguments()[i];
+            continue;
+        }
         else if (arguments()[i]=="-w")
-            forceOverwrite = true;
+            opt.forceOverwrite = true;
         else if (arguments()[i]=="-s")
-            forceSingleFile = true;
+            opt.forceSingleFile = true;
         else if (arguments()[i]=="-d")
-            forceDirectory = true;
+            opt.forceDirectory = true;
         else if (arguments()[i]=="-fe")
-            filterExclusive = true;
+            opt.filterExclusive = true;
         else if (arguments()[i]=="-fr")
-            filterReverse = true;
+            opt.filterReverse = true;
         else if (arguments()[i]=="--swap-names")
-            swapNames = true;
+            opt.swapNames = true;
         else if (arguments()[i]=="--split-names")
-            splitNames = true;
+            opt.splitNames = true;
         else if (arguments()[i]=="--generate-full-names")
-            generateFullNames = true;
+            opt.generateFullNames = true;
         else if (arguments()[i]=="--drop-full-names")
-            dropFullNames = true;
+            opt.dropFullNames = true;
         else if (arguments()[i]=="--reverse-full-names")
-            reverseFullNames = true;
+            opt.reverseFullNames = true;
         else if (arguments()[i]=="--drop-slashes")
-            dropSlashes = true;
+            opt.dropSlashes = true;
         else if (arguments()[i]=="--filter") {
             i++;
             if (i==arguments().count()) {
@@ -149,7 +233,7 @@ int Convertor::start()
                 printUsage();
                 return 10;
             }
-            filterString = arguments()[i];
+            opt.filterString = arguments()[i];
         }
         else {
             out << tr("Unknown option: %1\n").arg(arguments()[i]);
@@ -157,209 +241,364 @@ int Convertor::start()
             return 11;
         }
     }
+    // Batch: inputs from manifest (with optional outputs) and/or many -i;
+    // empty output means output by -o template
+    QStringList outPaths;
+    for (int i=0; i<inPaths.count(); i++)
+        outPaths << QString();
+    bool batchMode = !batchPath.isEmpty() || inPaths.count()>1;
+    if (!batchPath.isEmpty() && !readManifest(batchPath, inPaths, outPaths))
+        return 27;
     // Check input data completion
-    if (inPath.isEmpty()) {
+    if (inPaths.isEmpty()) {
         out << tr("Error: Input path is missing\n");
         printUsage();
         return 12;
     }
-    if (outPath.isEmpty() && !infoMode) {
+    if (outPath.isEmpty() && !opt.infoMode && outPaths.contains(QString())) {
         out << tr("Error: Output path is missing\n");
         printUsage();
         return 13;
     }
-    if (outFormat.isEmpty() && !infoMode) {
+    if (opt.outFormat.isEmpty() && !opt.infoMode) {
         out << tr("Error: Output format name is missing\n");
         printUsage();
         return 14;
     }
-    if (outFormat=="csv") {
-        if (outProfile.isEmpty()) {
+    if (opt.outFormat=="csv") {
+        if (opt.outProfile.isEmpty()) {
             out << tr("Error: Output format is CSV, but profile name is missing\n");
             printUsage();
             return 15;
         }
     }
     else {
-        if (!outProfile.isEmpty()) {
+        if (!opt.outProfile.isEmpty()) {
             out << tr("Error: Output format isn't' CSV, but profile name is present\n");
             printUsage();
             return 16;
         }
     }
-    if (forceSingleFile && forceDirectory) {
+    if (opt.forceSingleFile && opt.forceDirectory) {
         out << tr("Error: Options -s and -d are not compatible\n");
         printUsage();
         return 17;
     }
-    if (forceDirectory && !outFormat.contains("vcf") && outFormat!="copy") {
+    if (opt.forceDirectory && !opt.outFormat.contains("vcf") && opt.outFormat!="copy") {
         out << tr("Error: -d option applicable only for vCard format");
         return 18;
     }
-    if (infoMode && !(outPath.isEmpty() && outFormat.isEmpty())) {
+    if (opt.infoMode && !(outPath.isEmpty() && opt.outFormat.isEmpty())) {
         out << tr("Error: Command --info is not compatible with -o and -f options\n");
         printUsage();
         return 19;
     }
-    if ((filterExclusive || filterReverse) && filterString.isEmpty()) {
+    if ((opt.filterExclusive || opt.filterReverse) && opt.filterString.isEmpty()) {
         out << tr("Error: -fe and -fr option applicable only with --filter command");
         return 20;
     }
+    if (batchMode && opt.infoMode) {
+        out << tr("Error: Command --info is applicable only for single input\n");
+        printUsage();
+        return 36;
+    }
+    if (inPaths.contains(STD_STREAM_PATH) && opt.inFormat.isEmpty()) {
+        out << tr("Error: Standard input can't be detected, --input-format option required\n");
+        printUsage();
+        return 33;
+    }
+    if (batchMode && (inPaths.contains(STD_STREAM_PATH) || outPath==STD_STREAM_PATH
+            || outPaths.contains(STD_STREAM_PATH))) {
+        out << tr("Error: Standard input and output are applicable only for single input\n");
+        printUsage();
+        return 35;
+    }
+    // Global settings are set once, before any job started
+    gd.preferredVCFVersion = (opt.outFormat=="vcf30") ? GlobalConfig::VCF30 : GlobalConfig::VCF21;
+    gd.useOriginalFileVersion = (opt.outFormat=="vcfauto" || opt.outFormat=="copy");
+    if (!batchMode)
+        return convert(opt, inPaths.first(), outPath, out);
+    // Outputs, missing in manifest, are made by -o template, numbered in input order
+    for (int i=0; i<inPaths.count(); i++)
+        if (outPaths[i].isEmpty())
+            outPaths[i] = expandTemplate(outPath, inPaths[i], i+1);
+    QSet<QString> uniqueOutPaths;
+    foreach (const QString& path, outPaths)
+        uniqueOutPaths.insert(QFileInfo(path).absoluteFilePath());
+    if (uniqueOutPaths.count()<outPaths.count()) {
+        out << tr("Error: Some inputs have the same output path, use %n or %i in -o template\n");
+        printUsage();
+        return 31;
+    }
+    return runBatch(opt, inPaths, outPaths, threadCount, logDir);
+}
+
+int Convertor::convert(const ConvertOptions &opt, const QString &inPath, const QString &outPath, QTextStream &log)
+{
+    bool isStdIn = (inPath==STD_STREAM_PATH);
+    bool isStdOut = (outPath==STD_STREAM_PATH);
     // Check if output file exists
     QFile of(outPath);
-    if (of.exists() && !forceOverwrite && !QFileInfo(outPath).isDir()) {
-        out << tr("Error: Output file already exists, use -w if necessary\n");
-        printUsage();
+    if (!isStdOut && of.exists() && !opt.forceOverwrite && !QFileInfo(outPath).isDir()) {
+        log << tr("Error: Output file already exists, use -w if necessary\n");
         return 21;
     }
     // Define, create file or directory at output
     // (default: as input)
-    FormatType ift = QFileInfo(inPath).isDir() ? ftDirectory : ftFile;
+    FormatType ift = (!isStdIn && QFileInfo(inPath).isDir()) ? ftDirectory : ftFile;
     FormatType oft = ift;
-    if (forceSingleFile)
+    if (opt.forceSingleFile)
         oft = ftFile;
-    else if (forceDirectory)
+    else if (opt.forceDirectory)
         oft = ftDirectory;
     // Read
     IFormat* iFormat = 0;
     FormatFactory factory;
-    if (ift==ftFile)
+    if (!opt.inFormat.isEmpty()) {
+        iFormat = FormatFactory::createByName(opt.inFormat);
+        factory.formatName = opt.inFormat;
+    }
+    else if (ift==ftFile)
         iFormat = factory.createObject(inPath);
     else
         iFormat = new VCFDirectory();
     if (!iFormat) {
-        out << factory.error << "\n";
+        log << factory.error << "\n";
         return 22;
     }
     // Input CSV profile
     CSVFile* csvFormat = dynamic_cast<CSVFile*>(iFormat);
     if (csvFormat) {
-        if (inProfile.isEmpty()) {
-            out << tr("Error: Input format is CSV, but profile name is missing\n");
-            printUsage();
+        if (opt.inProfile.isEmpty()) {
+            log << tr("Error: Input format is CSV, but profile name is missing\n");
             delete iFormat;
             return 23;
         }
         else
-            setCSVProfile(csvFormat, inProfile);
+            setCSVProfile(csvFormat, opt.inProfile);
     }
     ContactList items;
     bool res = iFormat->importRecords(inPath, items, false);
-    logFormat(iFormat);
+    logFormat(iFormat, log);
     delete iFormat;
     if (!res)
         return 24;
-    out << tr("%1 records read\n").arg(items.count());
+    log << tr("%1 records read\n").arg(items.count());
     // Show statistics, if info mode switched on
-    if (infoMode) {
-        out << "\n" << items.statistics() << "\n";
+    if (opt.infoMode) {
+        log << "\n" << items.statistics() << "\n";
+        log << "\n" << items.memoryReport().toString(items.count()) << "\n";
         return 0;
     }
     // Conversions
     for (int i=0; i<items.count(); i++) {
         ContactItem& item = items[i];
         bool filtered = true;
-        if (!filterString.isEmpty()) {
-            filtered = item.fullName.contains(filterString);
+        if (!opt.filterString.isEmpty()) {
+            filtered = item.fullName.contains(opt.filterString);
             if (!filtered)
                 foreach (const QString& name, item.names)
-                    if (name.contains(filterString))
+                    if (name.contains(opt.filterString))
                         filtered = true;
             if (!filtered)
-                if (item.description.contains(filterString))
+                if (item.description.contains(opt.filterString))
                     filtered = true;
             if (!filtered)
                 foreach (const Phone& p, item.phones)
-                    if (p.value.contains(filterString))
+                    if (p.value.contains(opt.filterString))
                         filtered = true;
             if (!filtered)
                 foreach (const Phone& p, item.phones)
-                    if (p.value.contains(filterString))
+                    if (p.value.contains(opt.filterString))
                         filtered = true;
             if (!filtered)
                 foreach (const Email& m, item.emails)
-                    if (m.value.contains(filterString))
+                    if (m.value.contains(opt.filterString))
                         filtered = true;
         }
-        if (filterReverse)
+        if (opt.filterReverse)
             filtered = !filtered;
         if (filtered) {
-            if (swapNames)
+            if (opt.swapNames)
                 item.swapNames();
-            if (splitNames)
+            if (opt.splitNames)
                 item.splitNames();
             // TODO splitNumbers now can't be implemented, because in GUI it works via ContactModel
             // Probably, move it in ContactList in future
-            if (generateFullNames)
+            if (opt.generateFullNames)
                 item.fullName = items[i].formatNames();
-            if (dropFullNames)
+            if (opt.dropFullNames)
                 item.fullName.clear();
-            if (reverseFullNames)
+            if (opt.generateFullNames || opt.dropFullNames)
+                item.calculateFields(ContactItem::fgName);
+            if (opt.reverseFullNames)
                 item.reverseFullName();
-            if (dropSlashes)
+            if (opt.dropSlashes)
                 item.dropSlashes();
             // TODO intlPhonePrefix implement after CountryManager create
             // items[i].intlPhonePrefix(cRule);
         }
-        else if (filterExclusive) {
+        else if (opt.filterExclusive) {
             items.removeAt(i);
             i--;
         }
     }
     //Define output format
-    gd.preferredVCFVersion = GlobalConfig::VCF21;
     IFormat* oFormat = 0;
-    if (oft==ftDirectory)
+    if (opt.outFormat=="vcfzip") // single file, even if input is directory
+        oFormat = new VCFArchive();
+    else if (oft==ftDirectory)
         oFormat = new VCFDirectory();
-    else if (outFormat.contains("vcf")) {
-        if (outFormat=="vcf30")
-            gd.preferredVCFVersion = GlobalConfig::VCF30;
-        gd.useOriginalFileVersion = (outFormat=="vcfauto");
+    else if (opt.outFormat.contains("vcf"))
         oFormat = new VCFFile();
-    }
-    else if (outFormat.contains("udx"))
+    else if (opt.outFormat.contains("udx"))
         oFormat = new UDXFile();
-    else if (outFormat.contains("mpb"))
+    else if (opt.outFormat.contains("mpb"))
         oFormat = new MPBFile();
-    else if (outFormat.contains("csv"))
+    else if (opt.outFormat.contains("csv"))
         oFormat = new CSVFile();
-    else if (outFormat.contains("html"))
+    else if (opt.outFormat.contains("html"))
         oFormat = new HTMLFile();
-    else { // copy input format
-        if (VCFFile::detect(inPath)) {
-            gd.useOriginalFileVersion = true;
-            oFormat = new VCFFile();
-        }
-        else if (UDXFile::detect(inPath))
-            oFormat = new UDXFile();
-        else if (MPBFile::detect(inPath))
-            oFormat = new MPBFile();
-        else if (CSVFile::detect(inPath))
-            oFormat = new CSVFile();
-        else {
-            out << "Error: Can't autodetect input format\n";
+    else if (opt.outFormat.contains("dcb"))
+        oFormat = new DCBFile();
+    else if (opt.outFormat=="ldif")
+        oFormat = new LDIFFile();
+    else if (opt.outFormat=="jcard")
+        oFormat = new JCardFile();
+    else { // copy input format, as detected when reading
+        QString inFormat = factory.formatName;
+        if (inFormat!="nbf" && inFormat!="html") // read-only and write-only
+            oFormat = FormatFactory::createByName(inFormat);
+        if (!oFormat) {
+            log << "Error: Can't autodetect input format\n";
             return 25;
         }
     }
+    // Formats with random access to output file (archive, placeholders) or many files
+    if (isStdOut && (dynamic_cast<VCFArchive*>(oFormat) || dynamic_cast<VCFDirectory*>(oFormat)
+            || dynamic_cast<UDXFile*>(oFormat))) {
+        log << tr("Error: This output format can't be written to standard output\n");
+        delete oFormat;
+        return 34;
+    }
+    // Zip is written only as vCard archive; other formats would put
+    // plain file bytes under .zip name (i.e. -f copy from zipped CSV)
+    if (!isStdOut && oft==ftFile && !dynamic_cast<VCFArchive*>(oFormat)
+            && VCFArchive::supportedExtensions().contains(QFileInfo(outPath).suffix())) {
+        log << tr("Error: Only vcfzip format can be written to zip archive\n");
+        delete oFormat;
+        return 37;
+    }
     // Output CSV profile
     csvFormat = dynamic_cast<CSVFile*>(oFormat);
     if (csvFormat)
-        setCSVProfile(csvFormat, outProfile);
+        setCSVProfile(csvFormat, opt.outProfile);
     // Write
     res = oFormat->exportRecords(outPath, items);
-    logFormat(oFormat);
+    logFormat(oFormat, log);
     delete oFormat;
-    out << tr("%1 records written\n").arg(items.count());
+    log << tr("%1 records written\n").arg(items.count());
     return res ? 0 : 26;
 }
 
+// All inputs are converted in one process, by worker pool;
+// job logs and statuses are reported in input order
+int Convertor::runBatch(const ConvertOptions &options, const QStringList &inPaths, const QStringList &outPaths,
+    int threadCount, const QString &logDir)
+{
+    if (!logDir.isEmpty() && !QDir().mkpath(logDir)) {
+        out << tr("Error: Can't create directory\n%1\n").arg(logDir);
+        return 29;
+    }
+    QList<ConvertJob*> jobs;
+    for (int i=0; i<inPaths.count(); i++)
+        jobs << new ConvertJob(options, inPaths[i], outPaths[i]);
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMin(threadCount, jobs.count()));
+    foreach (ConvertJob* job, jobs)
+        pool.start(job);
+    QStringList failed;
+    for (int i=0; i<jobs.count(); i++) {
+        ConvertJob* job = jobs[i];
+        job->done.acquire();
+        out << QString("[%1/%2] %3 -> %4\n").arg(i+1).arg(jobs.count()).arg(job->inPath).arg(job->outPath);
+        if (logDir.isEmpty())
+            out << job->logText;
+        else {
+            // Job number makes name unique, even for same output names in different directories
+            QFile logFile(logDir + QDir::separator() + QString("%1-%2.log")
+                .arg(i+1, QString::number(jobs.count()).length(), 10, QChar('0'))
+                .arg(QFileInfo(job->outPath).fileName()));
+            if (logFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                QTextStream log(&logFile);
+                log << job->logText << tr("Exit status: %1\n").arg(job->exitCode);
+            }
+            else
+                out << S_WRITE_ERR.arg(logFile.fileName()) << "\n" << job->logText;
+        }
+        if (job->exitCode==0)
+            out << tr("Done\n");
+        else {
+            out << tr("Failed, exit status %1\n").arg(job->exitCode);
+            failed << QString("%1 (%2)").arg(job->inPath).arg(job->exitCode);
+        }
+        out.flush();
+        job->logText.clear(); // don't keep logs of reported jobs
+    }
+    pool.waitForDone();
+    qDeleteAll(jobs);
+    // Summary
+    out << tr("\n%1 inputs converted, %2 failed\n").arg(inPaths.count()-failed.count()).arg(failed.count());
+    foreach (const QString& s, failed)
+        out << s << "\n";
+    return failed.isEmpty() ? 0 : 30;
+}
+
+bool Convertor::readManifest(const QString &path, QStringList &inPaths, QStringList &outPaths)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        out << S_READ_ERR.arg(path) << "\n";
+        return false;
+    }
+    // Each line: input path, optionally tab and output path
+    QTextStream stream(&f);
+#if QT_VERSION < 0x060000
+    stream.setCodec("UTF-8");
+#endif
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+        if (line.trimmed().isEmpty() || line.startsWith('#'))
+            continue;
+        int tabPos = line.indexOf('\t');
+        if (tabPos==-1) {
+            inPaths << line.trimmed();
+            outPaths << QString(); // by template
+        }
+        else {
+            inPaths << line.left(tabPos).trimmed();
+            outPaths << line.mid(tabPos+1).trimmed();
+        }
+    }
+    return true;
+}
+
+QString Convertor::expandTemplate(const QString &outTemplate, const QString &inPath, int index)
+{
+    QString res = outTemplate;
+    res.replace("%n", QFileInfo(inPath).completeBaseName());
+    res.replace("%i", QString::number(index));
+    return res;
+}
+
 // Print program usage
 void Convertor::printUsage()
 {
     out << tr(
         "Usage:\n" \
-        "contconv -i inputfile -o outfile -f outformat [-ip csvprofile] [-op csvprofile] [-w] [-d|-s] [commands]\n" \
-        "contconv --info inputfile\n" \
+        "contconv -i inputfile -o outfile -f outformat [--input-format informat] [-ip csvprofile] [-op csvprofile] [-w] [-d|-s] [commands]\n" \
+        "contconv --info inputfile [--input-format informat]\n" \
+        "contconv -i inputfile [-i inputfile...] [--batch manifest] -o outtemplate -f outformat [options] [commands]\n" \
         "\n" \
         "Possible values for outformat:\n" \
         "copy - same as input format, if atodetected\n" \
@@ -367,17 +606,39 @@ void Convertor::printUsage()
         "vcf21 - vCard version 2.1\n" \
         "vcf30 - vCard version 3.0\n" \
         "vcfauto - vCard version as in input file\n" \
+        "vcfzip - zip archive of vCard files, one per contact\n" \
         "udx - Philips Xenium UDX\n" \
         "mpb - MyPhoneExplorer backup\n" \
          "html - HTML report (write only)\n" \
+        "dcb - DoubleContact binary snapshot (opened without text parsing, keeps MPB extra data)\n" \
+        "ldif - LDAP Data Interchange Format\n" \
+        "jcard - jCard (vCard in JSON, RFC 7095)\n" \
+        "vCard, CSV and LDIF files can be gzip-compressed (*.vcf.gz, *.csv.gz, *.ldif.gz);\n" \
+        "inputfile also can be zip archive with vCard, CSV or LDIF file\n" \
+        "\n" \
+        "Standard input and output:\n" \
+        "- as inputfile means standard input; --input-format informat option is required,\n" \
+        "where informat is vcf, csv, udx, mpb, dcb, ldif or jcard (input must be uncompressed);\n" \
+        "- as outfile means standard output (not for udx, vcfzip and -d); messages go to stderr.\n" \
+        "Example: zcat big.vcf.gz | contconv -i - --input-format vcf -f csv -op generic -o -\n" \
         "\n" \
         "Possible values for csvprofile:\n" \
-        "explaybm50, explaytv240, generic\n" \
+        "explaybm50, explaytv240, osmo, generic\n" \
+        "or name of profile, loaded from *.csvprofile data file\n" \
         "\n" \
         "Options:\n" \
         "-w - force overwrite output single file, if exists (directories overwrites already)\n" \
         "-s - write VCF as single file (by default, write as in input)\n" \
         "-d - write VCFs as directory (not compatible with -d)\n" \
+        "\n" \
+        "Batch conversion (several -i options and/or --batch):\n" \
+        "--batch manifest - read inputs from text file, one per line;\n" \
+        "line may contain tab and output path; empty lines and lines starting with # are skipped\n" \
+        "-o outtemplate - output path for inputs without explicit output;\n" \
+        "%n is replaced by input base name, %i by input number (from 1)\n" \
+        "--threads count - number of parallel conversions (default: number of CPU cores)\n" \
+        "--log-dir dir - write log of each conversion to dir/<number>-<output name>.log\n" \
+        "Exit code is non-zero, if any conversion failed; summary is printed at end\n" \
         "Commands:\n" \
         "--swap-names - swap first and last name\n" \
         "--split-names - split name by spaces\n" \
@@ -394,12 +655,12 @@ void Convertor::printUsage()
         "\n");
 }
 
-void Convertor::logFormat(IFormat* format)
+void Convertor::logFormat(IFormat* format, QTextStream& log)
 {
     foreach (const QString& s, format->errors())
-        out << s << "\n";
+        log << s << "\n";
     if (!format->fatalError().isEmpty())
-        out << "Error: " << format->fatalError() << "\n";
+        log << "Error: " << format->fatalError() << "\n";
 }
 
 void Convertor::setCSVProfile(CSVFile *csvFormat, const QString &code)
@@ -408,6 +669,25 @@ void Convertor::setCSVProfile(CSVFile *csvFormat, const QString &code)
         csvFormat->setProfile("Explay BM50");
     else if (code=="explaytv240")
         csvFormat->setProfile("Explay TV240");
-    else
+    else if (code=="osmo")
+        csvFormat->setProfile("Osmo PIM");
+    else if (!csvFormat->setProfile(code)) // profile name from data file
         csvFormat->setProfile("Generic profile");
 }
+
+// Status messages mustn't be mixed with converted data
+bool Convertor::isStdOutUsed()
+{
+    for (int i=1; i<arguments().count()-1; i++)
+        if (arguments()[i]=="-o" && arguments()[i+1]==STD_STREAM_PATH)
+            return true;
+    return false;
+}
+
+bool Convertor::isCSVProfile(const QString &code)
+{
+    if (code=="explaybm50" || code=="explaytv240" || code=="osmo" || code=="generic")
+        return true;
+    CSVFile csvFormat;
+    return csvFormat.setProfile(code); // profile name from data file
+}
@@ -21,16 +21,45 @@
 #include "formats/iformat.h"
 #include "formats/files/csvfile.h"
 
+// Conversion settings, common for all inputs of one run
+struct ConvertOptions {
+    QString inFormat; // if empty, detected by input file; required for standard input
+    QString outFormat, inProfile, outProfile, filterString;
+    bool infoMode;
+    bool forceOverwrite;
+    bool forceSingleFile;
+    bool forceDirectory;
+    bool swapNames;
+    bool splitNames;
+    bool generateFullNames;
+    bool dropFullNames;
+    bool reverseFullNames;
+    bool dropSlashes;
+    bool filterExclusive;
+    bool filterReverse;
+    ConvertOptions();
+};
+
 class Convertor : public QCoreApplication
 {
 public:
     Convertor(int &argc, char **argv);
     int start();
     void printUsage();
+    // One input to one output; thread-safe, if global settings are prepared before.
+    // Returns exit status
+    static int convert(const ConvertOptions& options, const QString& inPath, const QString& outPath,
+        QTextStream& log);
 private:
-    QTextStream out;
-    void logFormat(IFormat* format);
-    void setCSVProfile(CSVFile* csvFormat, const QString& code);
+    QTextStream out; // stderr, if converted data is written to stdout
+    static bool isStdOutUsed();
+    int runBatch(const ConvertOptions& options, const QStringList& inPaths, const QStringList& outPaths,
+        int threadCount, const QString& logDir);
+    bool readManifest(const QString& path, QStringList& inPaths, QStringList& outPaths);
+    static QString expandTemplate(const QString& outTemplate, const QString& inPath, int index);
+    static void logFormat(IFormat* format, QTextStream& log);
+    static void setCSVProfile(CSVFile* csvFormat, const QString& code);
+    static bool isCSVProfile(const QString& code);
 };
 
 #endif // CONVERTOR_H
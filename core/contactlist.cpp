@@ -11,6 +11,7 @@
  *
  */
 
+#include <QTextCodec>
 #include "contactlist.h"
 
 // Rules for phone number internationalization
@@ -186,6 +187,10 @@ void Messenger::StandardTypes::fill()
             << (*this)["xmpp"]  << (*this)["icq"]  << (*this)["skype"] << (*this)["pref"];
 }
 
+ContactItem::ContactItem()
+    :pairState(PairNotFound), pairItem(0), pairIndex(-1), dirtyFields(fgAll)
+{}
+
 void ContactItem::clear()
 {
     fullName.clear();
@@ -205,12 +210,10 @@ void ContactItem::clear()
     originalFormat.clear();
     version.clear();
     subVersion.clear();
-    prefPhone.clear();
-    prefEmail.clear();
-    prefIM.clear();
     nickName.clear();
     url.clear();
     ims.clear();
+    dirtyFields = fgAll;
 }
 
 bool ContactItem::swapNames()
@@ -222,6 +225,7 @@ bool ContactItem::swapNames()
     names[0] = names[1];
     names[1] = buffer;
     dropFinalEmptyNames();
+    dirtyFields |= fgName;
     return true;
 }
 
@@ -237,6 +241,8 @@ bool ContactItem::splitNames()
             res = true;
         }
     }
+    if (res)
+        dirtyFields |= fgName;
     return res;
 }
 
@@ -250,6 +256,7 @@ bool ContactItem::dropSlashes()
             if (names[i][len-2]=='/' && names[i][len-1].isDigit())
                 names[i].remove(len-2, 2);
     }
+    dirtyFields |= fgName;
     return true;
 }
 
@@ -262,43 +269,88 @@ bool ContactItem::intlPhonePrefix(int countryRule)
             res = true;
         phones[i].value = newNumber;
     }
+    if (res) // phone also may be visible name
+        dirtyFields |= fgPhones | fgName;
     return res;
 }
 
-void ContactItem::calculateFields()
+template<class T>
+QString ContactItem::prefValue(const QList<T> &values)
 {
-    // Visible name (depend of filled fields)
-    visibleName = makeGenericName();
-    // First or preferred phone number
-    prefPhone.clear();
-    if (phones.count()>0) {
-        prefPhone = phones[0].value;
-        for (int i=0; i<phones.count();i++) {
-            if (phones[i].types.contains("pref", Qt::CaseInsensitive))
-                prefPhone = phones[i].value;
-        }
-    }
-    // First or preferred email
-    prefEmail.clear();
-    if (emails.count()>0) {
-        prefEmail = emails[0].value;
-        for (int i=0; i<emails.count(); i++)
-            if (emails[i].types.contains("pref", Qt::CaseInsensitive))
-                prefEmail = emails[i].value;
-    }
-    // First or preferred IM
-    prefIM.clear();
-    if (ims.count()>0) {
-        prefIM = ims[0].value;
-        for (int i=0; i<ims.count(); i++)
-            if (ims[i].types.contains("pref", Qt::CaseInsensitive))
-                prefIM = ims[i].value;
+    QString res;
+    if (values.count()>0) {
+        res = values[0].value;
+        for (int i=0; i<values.count(); i++)
+            if (values[i].types.contains("pref", Qt::CaseInsensitive))
+                res = values[i].value;
     }
-    // Type sorting and lowercasing for correct compare
-    sortTypes(phones);
-    sortTypes(emails);
-    sortTypes(addrs);
-    sortTypes(ims);
+    return res;
+}
+
+const QString& ContactItem::visibleName() const
+{
+    recalculate(fgName);
+    return _visibleName;
+}
+
+const QString& ContactItem::prefPhone() const
+{
+    recalculate(fgPhones);
+    return _prefPhone;
+}
+
+const QString& ContactItem::prefEmail() const
+{
+    recalculate(fgEmails);
+    return _prefEmail;
+}
+
+const QString& ContactItem::prefIM() const
+{
+    recalculate(fgIMs);
+    return _prefIM;
+}
+
+void ContactItem::calculateFields(int groups)
+{
+    // Type sorting and lowercasing for correct compare.
+    // Types are compared and exported, so it can't be delayed
+    if (groups & fgPhones)
+        sortTypes(phones);
+    if (groups & fgEmails)
+        sortTypes(emails);
+    if (groups & fgAddrs)
+        sortTypes(addrs);
+    if (groups & fgIMs)
+        sortTypes(ims);
+    // Visible name may contain email or phone
+    if (groups & (fgPhones | fgEmails))
+        groups |= fgName;
+    // Other fields will be recalculated on first read
+    dirtyFields |= groups;
+}
+
+void ContactItem::updateFields()
+{
+    recalculate(fgAll);
+}
+
+void ContactItem::recalculate(int groups) const
+{
+    groups &= dirtyFields;
+    if (!groups)
+        return;
+    // Visible name (depend of filled fields)
+    if (groups & fgName)
+        _visibleName = makeGenericName();
+    // First or preferred phone number, email, IM
+    if (groups & fgPhones)
+        _prefPhone = prefValue(phones);
+    if (groups & fgEmails)
+        _prefEmail = prefValue(emails);
+    if (groups & fgIMs)
+        _prefIM = prefValue(ims);
+    dirtyFields &= ~groups;
 }
 
 template<class T>
@@ -367,9 +419,11 @@ QString ContactItem::makeGenericName() const
 void ContactItem::reverseFullName()
 {
     int sPos = fullName.indexOf(" ");
-    if (sPos!=-1)
+    if (sPos!=-1) {
         fullName = fullName.right(fullName.length()-sPos-1)
            + " " + fullName.left(sPos);
+        dirtyFields |= fgName;
+    }
 }
 
 void ContactItem::dropFinalEmptyNames()
@@ -490,17 +544,111 @@ const QString ContactItem::findIMByType(const QString &itemType) const
 }
 
 ContactList::ContactList()
+    :idIndexEnabled(false), idIndexValid(false)
+{
+}
+
+void ContactList::updateFields()
 {
+    for (int i=0; i<count(); i++)
+        (*this)[i].updateFields();
+}
+
+void ContactList::reserveRecords(int newRecordCount)
+{
+#if QT_VERSION >= 0x040700
+    if (newRecordCount>0)
+        reserve(count()+newRecordCount);
+#else
+    Q_UNUSED(newRecordCount);
+#endif
 }
 
 int ContactList::findById(const QString &idValue)
+{
+    if (idIndexEnabled) {
+        if (!idIndexValid)
+            buildIdIndex();
+        int i = idIndex.value(idValue, -1);
+        // Protection from ids changed without invalidateIdIndex() call
+        if (i!=-1 && i<count() && at(i).id==idValue)
+            return i;
+        // List can be changed via QList methods, bypassing index (operator<<,
+        // replace(), non-const operator[], etc.), so miss is checked by linear search
+        i = findByIdLinear(idValue);
+        if (i!=-1)
+            buildIdIndex();
+        return i;
+    }
+    return findByIdLinear(idValue);
+}
+
+int ContactList::findByIdLinear(const QString &idValue) const
 {
     for(int i=0; i<count(); i++)
-        if ((*this)[i].id==idValue)
+        if (at(i).id==idValue)
             return i;
     return -1;
 }
 
+void ContactList::setIdIndexEnabled(bool enabled)
+{
+    idIndexEnabled = enabled;
+    invalidateIdIndex();
+}
+
+void ContactList::invalidateIdIndex()
+{
+    idIndex.clear();
+    idIndexValid = false;
+}
+
+void ContactList::buildIdIndex()
+{
+    idIndex.clear();
+    idIndex.reserve(count());
+    // Reverse order, so first record with given id wins, as in linear search
+    for (int i=count()-1; i>=0; i--)
+        idIndex[at(i).id] = i;
+    idIndexValid = true;
+}
+
+// Index is rebuilt lazily, on next findById() call, because
+// importers usually fill record id after record appending
+void ContactList::push_back(const ContactItem &item)
+{
+    QList<ContactItem>::push_back(item);
+    idIndexValid = false;
+}
+
+void ContactList::append(const ContactItem &item)
+{
+    QList<ContactItem>::append(item);
+    idIndexValid = false;
+}
+
+void ContactList::insert(int i, const ContactItem &item)
+{
+    QList<ContactItem>::insert(i, item);
+    idIndexValid = false;
+}
+
+void ContactList::removeAt(int i)
+{
+    QList<ContactItem>::removeAt(i);
+    idIndexValid = false;
+}
+
+void ContactList::appendRecords(const QList<ContactItem> &records)
+{
+    // Empty list takes implicitly shared data instead of copying each record
+    if (isEmpty())
+        QList<ContactItem>::operator=(records);
+    else
+        QList<ContactItem>::append(records);
+    idIndexValid = false;
+}
+
 void ContactList::compareWith(ContactList &pairList)
 {
     for (int i=0; i<pairList.count(); i++)
@@ -547,11 +695,12 @@ void ContactList::compareWith(ContactList &pairList)
 void ContactList::clear()
 {
     QList<ContactItem>::clear();
+    invalidateIdIndex();
     extra.clear();
     originalProfile.clear();
 }
 
-QString ContactList::statistics()
+QString ContactList::statistics() const
 {
     int phoneCount = 0;
     int emailCount = 0;
@@ -564,13 +713,130 @@ QString ContactList::statistics()
         if (!item.birthday.isEmpty())
             bdayCount++;
     }
-    return QObject::
+    QString res = QObject::
         tr("%1 records\n%2 phones\n%3 emails\n%4 addresses\n%5 birthdays\n%6 calls\n%7 SMS\n%8 archived SMS\n%9 %10")
         .arg(count()).arg(phoneCount).arg(emailCount).arg(addrCount).arg(bdayCount)
-        .arg(extra.calls.count()).arg(extra.SMS.count()).arg(extra.SMSArchive.count())
+        .arg(extra.calls().count())
+        .arg(extra.lines(MPBExtra::secSMS).count()).arg(extra.lines(MPBExtra::secSMSArchive).count())
         .arg(extra.model).arg(extra.timeStamp);
+    // Calls are decoded above, maybe first time
+    foreach (const QString& error, extra.decodeErrors())
+        res += "\n" + error;
+    return res;
 }
 
+// Memory estimation helpers (implicit sharing isn't taken into account)
+#define CONTAINER_DATA_HEADER 24
+
+static qint64 stringSize(const QString& s)
+{
+    if (s.isNull())
+        return 0;
+    return CONTAINER_DATA_HEADER + (s.capacity()+1)*sizeof(QChar);
+}
+
+static qint64 stringListSize(const QStringList& l)
+{
+    qint64 res = l.isEmpty() ? 0 : CONTAINER_DATA_HEADER + l.count()*(sizeof(void*)+sizeof(QString));
+    foreach (const QString& s, l)
+        res += stringSize(s);
+    return res;
+}
+
+static qint64 typedItemSize(const TypedStringItem& item)
+{
+    return stringListSize(item.types) + stringSize(item.value);
+}
+
+static qint64 typedItemSize(const PostalAddress& item)
+{
+    return stringListSize(item.types)
+        + stringSize(item.offBox) + stringSize(item.extended) + stringSize(item.street)
+        + stringSize(item.city) + stringSize(item.region)
+        + stringSize(item.postalCode) + stringSize(item.country);
+}
+
+template<class T>
+static qint64 typedItemsSize(const QList<T>& l)
+{
+    // QList stores large items as pointers to heap nodes
+    qint64 res = l.isEmpty() ? 0 : CONTAINER_DATA_HEADER + l.count()*(sizeof(void*)+sizeof(T));
+    foreach (const T& item, l)
+        res += typedItemSize(item);
+    return res;
+}
+
+static qint64 tagsSize(const QList<TagValue>& l)
+{
+    qint64 res = l.isEmpty() ? 0 : CONTAINER_DATA_HEADER + l.count()*(sizeof(void*)+sizeof(TagValue));
+    foreach (const TagValue& tv, l)
+        res += stringSize(tv.tag) + stringSize(tv.value);
+    return res;
+}
+
+MemoryReport ContactList::memoryReport() const
+{
+    MemoryReport r;
+    r.other = sizeof(ContactList) + CONTAINER_DATA_HEADER + count()*sizeof(void*)
+        + stringSize(originalProfile);
+    foreach (const ContactItem& item, *this) {
+        r.names += stringSize(item.fullName) + stringListSize(item.names)
+            + stringSize(item.sortString) + stringSize(item.nickName);
+        r.typedItems += typedItemsSize(item.phones) + typedItemsSize(item.emails)
+            + typedItemsSize(item.addrs) + typedItemsSize(item.ims);
+        r.photos += stringSize(item.photo.pType) + stringSize(item.photo.url);
+        if (!item.photo.data.isNull())
+            r.photos += CONTAINER_DATA_HEADER + item.photo.data.capacity();
+        r.tags += tagsSize(item.otherTags) + tagsSize(item.unknownTags);
+        r.other += sizeof(ContactItem)
+            + stringSize(item.description) + stringSize(item.organization)
+            + stringSize(item.title) + stringSize(item.url) + stringSize(item.id)
+            + stringSize(item.originalFormat) + stringSize(item.version) + stringSize(item.subVersion)
+            + (item.anniversaries.isEmpty() ? 0 :
+                CONTAINER_DATA_HEADER + item.anniversaries.count()*(sizeof(void*)+sizeof(DateItem)));
+    }
+    r.extra = stringSize(extra.model) + stringSize(extra.timeStamp);
+    // Don't decode MPB sections only for estimation
+    for (int i=0; i<MPBExtra::secCount; i++) {
+        MPBExtra::Section section = (MPBExtra::Section)i;
+        if (extra.hasRaw(section) && !extra.raw(section).isNull())
+            r.extra += CONTAINER_DATA_HEADER + extra.raw(section).capacity();
+        if (!extra.isDecoded(section))
+            continue;
+        if (section!=MPBExtra::secCalls) {
+            r.extra += stringListSize(extra.lines(section));
+            continue;
+        }
+        const QList<CallInfo>& calls = extra.calls();
+        if (!calls.isEmpty())
+            r.extra += CONTAINER_DATA_HEADER + calls.count()*(sizeof(void*)+sizeof(CallInfo));
+        foreach (const CallInfo& call, calls)
+            r.extra += stringSize(call.cType) + stringSize(call.timeStamp) + stringSize(call.duration)
+                + stringSize(call.number) + stringSize(call.name);
+    }
+    return r;
+}
+
+MemoryReport::MemoryReport()
+    :names(0), typedItems(0), photos(0), tags(0), other(0), extra(0)
+{}
+
+qint64 MemoryReport::total() const
+{
+    return names + typedItems + photos + tags + other + extra;
+}
+
+QString MemoryReport::toString(int recordCount) const
+{
+    return QObject::
+        tr("Estimated memory usage, bytes:\nnames: %1\nphones/emails/addresses/IMs: %2\nphotos: %3\nother and unknown tags: %4\nother fields: %5\nSMS, calls and other MPB data: %6\ntotal: %7\nper record: %8")
+        .arg(names).arg(typedItems).arg(photos).arg(tags).arg(other).arg(extra).arg(total())
+        .arg(recordCount>0 ? (total()-extra)/recordCount : 0);
+}
+
+TagValue::TagValue()
+{}
+
 TagValue::TagValue(const QString& _tag, const QString& _value)
     :tag(_tag), value(_value)
 {}
@@ -721,15 +987,131 @@ void PostalAddress::StandardTypes::fill()
         << (*this)["intl"] << (*this)["postal"] << (*this)["parcel"];
 }
 
+MPBExtra::MPBExtra()
+{
+    clear();
+}
+
+const QStringList &MPBExtra::lines(MPBExtra::Section section) const
+{
+    decode(section);
+    return decodedLines[section];
+}
+
+const QList<CallInfo> &MPBExtra::calls() const
+{
+    decode(secCalls);
+    return decodedCalls;
+}
+
+QStringList &MPBExtra::editLines(MPBExtra::Section section)
+{
+    decode(section);
+    rawData[section].clear();
+    rawValid[section] = false;
+    return decodedLines[section];
+}
+
+QList<CallInfo> &MPBExtra::editCalls()
+{
+    decode(secCalls);
+    rawData[secCalls].clear();
+    rawValid[secCalls] = false;
+    return decodedCalls;
+}
+
+void MPBExtra::setRaw(MPBExtra::Section section, const QByteArray &data)
+{
+    rawData[section] = data;
+    rawValid[section] = true;
+    decoded[section] = false;
+    decodedLines[section].clear();
+    if (section==secCalls)
+        decodedCalls.clear();
+}
+
+bool MPBExtra::hasRaw(MPBExtra::Section section) const
+{
+    return rawValid[section];
+}
+
+bool MPBExtra::isDecoded(MPBExtra::Section section) const
+{
+    return decoded[section];
+}
+
+const QByteArray &MPBExtra::raw(MPBExtra::Section section) const
+{
+    return rawData[section];
+}
+
+const char *MPBExtra::codecName(MPBExtra::Section section)
+{
+    return (section==secSMSArchive) ? "CP1251" : "UTF-8"; // TODO check with various countries/locales.
+}
+
+QStringList MPBExtra::decodeLines(const QByteArray &data, const char *codecName)
+{
+    QStringList lines = QTextCodec::codecForName(codecName)->toUnicode(data).split('\n');
+    if (!lines.isEmpty() && lines.last().isEmpty()) // after last line end
+        lines.removeLast();
+    for (int i=0; i<lines.count(); i++)
+        if (lines[i].endsWith('\r'))
+            lines[i].chop(1);
+    return lines;
+}
+
+const QStringList &MPBExtra::decodeErrors() const
+{
+    return _decodeErrors;
+}
+
+QStringList MPBExtra::takeDecodeErrors()
+{
+    QStringList res = _decodeErrors;
+    _decodeErrors.clear();
+    return res;
+}
+
 void MPBExtra::clear()
 {
     model.clear();
     timeStamp.clear();
-    organizer.clear();
-    notes.clear();
-    SMS.clear();
-    SMSArchive.clear();
-    calls.clear();
+    for (int i=0; i<secCount; i++) {
+        rawData[i].clear();
+        rawValid[i] = false;
+        decoded[i] = true; // nothing to decode
+        decodedLines[i].clear();
+    }
+    decodedCalls.clear();
+    _decodeErrors.clear();
+}
+
+void MPBExtra::decode(MPBExtra::Section section) const
+{
+    if (decoded[section])
+        return;
+    decoded[section] = true;
+    QStringList lines = decodeLines(rawData[section], codecName(section));
+    if (section!=secCalls) {
+        decodedLines[section] = lines;
+        return;
+    }
+    foreach (const QString& line, lines) {
+        QStringList cells = line.split('\t');
+        if (cells.count()!=6)
+            _decodeErrors << QObject::tr("Strange call item: %1, size %2")
+                       .arg(line).arg(cells.count());
+        if (cells.count()>=6) {
+            CallInfo call;
+            call.cType = cells[0];
+            call.timeStamp = cells[1];
+            call.duration = cells[2];
+            call.number = cells[3];
+            call.name = cells[4];
+            decodedCalls << call;
+        }
+    }
 }
 
 bool Photo::operator ==(const Photo &p) const
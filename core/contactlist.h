@@ -16,6 +16,7 @@
 
 #include <QByteArray>
 #include <QDateTime>
+#include <QHash>
 #include <QStringList>
 #include "globals.h"
 
@@ -28,6 +29,7 @@
 // TODO m.b. use QMap<QString,QString>?
 struct TagValue { // for non-editing ang unknown tags
     QString tag, value;
+    TagValue();
     TagValue(const QString& _tag, const QString& _value);
 };
 
@@ -153,8 +155,15 @@ struct ContactItem {
     QString version, subVersion;
     QList<TagValue> otherTags;   // Known but un-editing tags
     QList<TagValue> unknownTags; // specific tags for any file format, i.e. vcf
-    // Calculated fields for higher perfomance
-    QString visibleName, prefPhone, prefEmail, prefIM;
+    // Field groups for calculated fields tracking
+    enum FieldGroup {
+        fgName   = 0x01, // visible name
+        fgPhones = 0x02, // preferred phone, phone types
+        fgEmails = 0x04, // preferred email, email types
+        fgIMs    = 0x08, // preferred IM, IM types
+        fgAddrs  = 0x10, // address types
+        fgAll    = 0x1F
+    };
     // Calculated fields for list comparison
     enum PairState {
         PairNotFound,
@@ -163,14 +172,25 @@ struct ContactItem {
     } pairState;
     ContactItem* pairItem;
     int pairIndex;
+    ContactItem();
     // Editing
     void clear();
     bool swapNames();
     bool splitNames(); // TODO int index
     bool dropSlashes();
     bool intlPhonePrefix(int countryRule);
+    // Calculated fields for higher perfomance
+    // They are recalculated lazily, on first read after calculateFields() call.
+    // Lazy read writes cache, so item with outdated fields must not be read
+    // from several threads; call updateFields() before sharing it
+    const QString& visibleName() const;
+    const QString& prefPhone() const;
+    const QString& prefEmail() const;
+    const QString& prefIM() const;
+    // Must be called after direct changes of fields in given groups
+    void calculateFields(int groups = fgAll);
+    void updateFields(); // recalculate outdated fields now
     // Aux methods
-    void calculateFields(); // For perfomance
     template<class T>
     void sortTypes(QList<T> &values); // Type sorting and lowercasing for correct compare
     QString formatNames() const;
@@ -181,6 +201,12 @@ struct ContactItem {
     bool identicalTo(const ContactItem& pair);
     static QString nameComponent(int compNum);
     const QString findIMByType(const QString& itemType) const;
+private:
+    mutable QString _visibleName, _prefPhone, _prefEmail, _prefIM;
+    mutable int dirtyFields; // FieldGroup flags for outdated calculated fields
+    void recalculate(int groups) const;
+    template<class T>
+    static QString prefValue(const QList<T>& values);
 };
 
 // MPB-specific storage
@@ -188,11 +214,60 @@ struct CallInfo {
     QString cType, timeStamp, duration, number, name;
 };
 
-struct MPBExtra {
+// Sections besides phonebook are kept as raw bytes of source file
+// and decoded only on first access; unchanged sections are saved verbatim.
+// Decoding in const accessors writes cache, so one MPBExtra must not be
+// read from several threads until its sections are decoded
+class MPBExtra {
+public:
+    enum Section {
+        secOrganizer,
+        secNotes,
+        secSMS,
+        secSMSArchive,
+        secCalls,
+        secCount
+    };
+    MPBExtra();
     QString model, timeStamp;
-    QStringList organizer, notes, SMS, SMSArchive;
-    QList<CallInfo> calls;
+    // Decoded content (for lines(), any section except secCalls)
+    const QStringList& lines(Section section) const;
+    const QList<CallInfo>& calls() const;
+    // Decoded content for change; raw bytes are dropped
+    QStringList& editLines(Section section);
+    QList<CallInfo>& editCalls();
+    // Raw content
+    void setRaw(Section section, const QByteArray& data);
+    bool hasRaw(Section section) const; // raw bytes are still valid
+    bool isDecoded(Section section) const;
+    const QByteArray& raw(Section section) const;
+    static const char* codecName(Section section);
+    static QStringList decodeLines(const QByteArray& data, const char* codecName);
+    // Strange call items, etc., found on first decode
+    const QStringList& decodeErrors() const;
+    QStringList takeDecodeErrors(); // for exporters; each error is reported once
     void clear();
+private:
+    mutable QByteArray rawData[secCount];
+    mutable bool rawValid[secCount];
+    mutable bool decoded[secCount];
+    mutable QStringList decodedLines[secCount];
+    mutable QList<CallInfo> decodedCalls;
+    mutable QStringList _decodeErrors;
+    void decode(Section section) const;
+};
+
+// Estimated memory usage of address book, in bytes
+struct MemoryReport {
+    qint64 names;      // full name, names, sort string, nickname
+    qint64 typedItems; // phones, emails, addresses, IMs
+    qint64 photos;
+    qint64 tags;       // otherTags, unknownTags
+    qint64 other;      // other contact fields and containers
+    qint64 extra;      // MPB-specific data (SMS, calls, etc.)
+    MemoryReport();
+    qint64 total() const;
+    QString toString(int recordCount) const;
 };
 
 // Entire address book
@@ -200,12 +275,32 @@ class ContactList : public QList<ContactItem>
 {
 public:
     ContactList();
+    void reserveRecords(int newRecordCount); // pre-size before bulk append
+    // Record search by id; with enabled index, found record costs O(1) instead of O(n)
+    // (missing id still costs O(n), because index can be stale)
     int findById(const QString& idValue);
+    void setIdIndexEnabled(bool enabled);
+    void invalidateIdIndex(); // must be called after direct change of item id
+    // Mutation methods, marking id index for rebuild
+    // (other QList methods bypass it; findById() stays correct, but slower)
+    void push_back(const ContactItem& item);
+    void append(const ContactItem& item);
+    void insert(int i, const ContactItem& item);
+    void removeAt(int i);
+    void appendRecords(const QList<ContactItem>& records); // bulk; shares data if list is empty
+    // Calculated fields of all records, before read from worker threads
+    void updateFields();
     void compareWith(ContactList& pairList);
     void clear();
-    QString statistics();
+    QString statistics() const;
+    MemoryReport memoryReport() const;
     MPBExtra extra;
     QString originalProfile; // for CSV; see also ContactItem::originalFormat
+private:
+    QHash<QString, int> idIndex; // id -> index of first record with this id
+    bool idIndexEnabled, idIndexValid;
+    void buildIdIndex();
+    int findByIdLinear(const QString& idValue) const;
 };
 
 #endif // CONTACTLIST_H
@@ -13,22 +13,30 @@ HEADERS	+= \
     $$PWD/contactlist.h \
     $$PWD/globals.h \
     $$PWD/languagemanager.h \
-    $$PWD/formats/iformat.h \
     $$PWD/formats/formatfactory.h \
+    $$PWD/formats/iformat.h \
     $$PWD/formats/common/vcarddata.h \
     $$PWD/formats/files/csvfile.h \
+    $$PWD/formats/files/dcbfile.h \
     $$PWD/formats/files/fileformat.h \
+    $$PWD/formats/files/filesniffer.h \
+    $$PWD/formats/files/htmlfile.h \
+    $$PWD/formats/files/jcardfile.h \
+    $$PWD/formats/files/ldiffile.h \
     $$PWD/formats/files/mpbfile.h \
     $$PWD/formats/files/nbffile.h \
+    $$PWD/formats/files/outputsink.h \
     $$PWD/formats/files/udxfile.h \
+    $$PWD/formats/files/vcfarchive.h \
     $$PWD/formats/files/vcfdirectory.h \
     $$PWD/formats/files/vcffile.h \
+    $$PWD/formats/files/zipvcardreader.h \
     $$PWD/formats/profiles/csvprofilebase.h \
+    $$PWD/formats/profiles/declarativecsvprofile.h \
     $$PWD/formats/profiles/explaybm50profile.h \
     $$PWD/formats/profiles/explaytv240profile.h \
     $$PWD/formats/profiles/genericcsvprofile.h \
-    $$PWD/formats/files/htmlfile.h \
-    ../core/formats/profiles/osmoprofile.h
+    $$PWD/formats/profiles/osmoprofile.h
 
 SOURCES	+= \
     $$PWD/contactlist.cpp \
@@ -37,16 +45,24 @@ SOURCES	+= \
     $$PWD/formats/formatfactory.cpp \
     $$PWD/formats/common/vcarddata.cpp \
     $$PWD/formats/files/csvfile.cpp \
+    $$PWD/formats/files/dcbfile.cpp \
     $$PWD/formats/files/fileformat.cpp \
+    $$PWD/formats/files/filesniffer.cpp \
+    $$PWD/formats/files/htmlfile.cpp \
+    $$PWD/formats/files/jcardfile.cpp \
+    $$PWD/formats/files/ldiffile.cpp \
     $$PWD/formats/files/mpbfile.cpp \
     $$PWD/formats/files/nbffile.cpp \
+    $$PWD/formats/files/outputsink.cpp \
     $$PWD/formats/files/udxfile.cpp \
+    $$PWD/formats/files/vcfarchive.cpp \
     $$PWD/formats/files/vcfdirectory.cpp \
     $$PWD/formats/files/vcffile.cpp \
+    $$PWD/formats/files/zipvcardreader.cpp \
     $$PWD/formats/profiles/csvprofilebase.cpp \
+    $$PWD/formats/profiles/declarativecsvprofile.cpp \
     $$PWD/formats/profiles/explaybm50profile.cpp \
     $$PWD/formats/profiles/explaytv240profile.cpp \
     $$PWD/formats/profiles/genericcsvprofile.cpp \
-    $$PWD/formats/files/htmlfile.cpp \
-    ../core/formats/profiles/osmoprofile.cpp
+    $$PWD/formats/profiles/osmoprofile.cpp
 
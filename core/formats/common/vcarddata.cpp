@@ -24,267 +24,85 @@
 VCardData::VCardData()
 {
     useOriginalFileVersion = gd.useOriginalFileVersion;
+    preferredVersion = gd.preferredVCFVersion;
     skipEncoding = false;
     skipDecoding = false;
     forceShortType = false;
     forceShortDate = false;
     formatVersion = GlobalConfig::VCF30;
+    typeCodec = 0;
 }
 
 bool VCardData::importRecords(QStringList &lines, ContactList& list, bool append, QStringList& errors)
 {
-    bool recordOpened = false;
-    QTextCodec* codec = QTextCodec::codecForName("UTF-8"); // non-standart types also may be non-latin
-    QString defaultEmptyPhoneType =  Phone::standardTypes.unTranslate(gd.defaultEmptyPhoneType);
-    ContactItem item;
+    beginImport(list, append);
+    // Merge quoted-printable linesets; count records to pre-size list
+    list.reserveRecords(mergeQPLines(lines));
+    collectRecords(lines, 0, list, errors);
+    return endImport(list, errors);
+}
+
+void VCardData::beginImport(ContactList &list, bool append)
+{
+    prepareImport();
     if (!append)
         list.clear();
+}
+
+void VCardData::importPortion(QStringList &lines, int firstLine, ContactList &list, QStringList &errors)
+{
+    // List isn't pre-sized here: reserve for each portion would reallocate it every time
+    mergeQPLines(lines);
+    collectRecords(lines, firstLine, list, errors);
+}
+
+bool VCardData::endImport(ContactList &list, QStringList &errors)
+{
+    // Unknown tags statistics
+    int totalUnknownTags = 0;
+    foreach (const ContactItem& _item, list)
+        totalUnknownTags += _item.unknownTags.count();
+    if (totalUnknownTags)
+        errors << QObject::tr("%1 unknown tags found").arg(totalUnknownTags);
+    // Ready
+    return (!list.isEmpty());
+}
+
+void VCardData::collectRecords(QStringList &lines, int firstLine, ContactList &list, QStringList &errors)
+{
+    bool recordOpened = false;
+    ContactItem* item = 0;
     QString visName = "";
-    // Merge quoted-printable linesets
-    for (int i=0; i<lines.count(); i++) {
-        if (i>=lines.count()) break; // need, because count changed inside this cycle
-        if (lines[i].contains("QUOTED-PRINTABLE", Qt::CaseInsensitive))
-            while (lines[i].right(1)=="=" && i<lines.count()-1) {
-                lines[i].remove(lines[i].length()-1, 1);
-                if (lines[i+1].left(1)=="\t") // Folding by tab, for example in Mozilla Thunderbird VCFs
-                    lines[i+1].remove(0, 1);
-                lines[i] += lines[i+1];
-                lines.removeAt(i+1);
-            }
-    }
-    // Collect records
     for (int line=0; line<lines.count(); line++) {
         const QString& s = lines[line];
         if (s.isEmpty()) // vcf can contain empty lines
             continue;
         if (s.startsWith("BEGIN:VCARD", Qt::CaseInsensitive)) {
-            if (recordOpened)
-                errors << QObject::tr("Unclosed record before line %1").arg(line+1);
+            if (recordOpened) {
+                errors << QObject::tr("Unclosed record before line %1").arg(firstLine+line+1);
+                item->clear(); // drop unclosed record, reuse its slot
+            }
+            else {
+                // Record is built in place, without copying into list
+                list.push_back(ContactItem());
+                item = &list.last();
+            }
             recordOpened = true;
-            item.clear();
             visName.clear();
-            item.originalFormat = "VCARD";
+            item->originalFormat = "VCARD";
         }
         else if (s.startsWith("END:VCARD", Qt::CaseInsensitive)) {
+            if (recordOpened)
+                item->calculateFields();
             recordOpened = false;
-            item.calculateFields();
-            list.push_back(item);
-        }
-        else {
-            // Split type:value
-            int scPos = s.indexOf(":");
-            if (scPos==-1) {
-                item.unknownTags.push_back(TagValue(s, ""));
-                continue;
-            }
-            QStringList vType = s.left(scPos).split(";");
-            QStringList vValue = s.mid(scPos+1).split(";");
-            const QString tag = vType[0].toUpper();
-            // Encoding, charset, types
-            encoding = "";
-            charSet = "";
-            QString typeVal = ""; // for PHOTO/URI, at least
-            QStringList types;
-            int syncMLRef = -1;
-            for (int i=1; i<vType.count(); i++) {
-                if (vType[i].startsWith("ENCODING=", Qt::CaseInsensitive))
-                    encoding = vType[i].mid(QString("ENCODING=").length()).toUpper();
-                else if (vType[i].startsWith("CHARSET=", Qt::CaseInsensitive))
-                    charSet = vType[i].mid(QString("CHARSET=").length());
-                else if (vType[i].startsWith("TYPE=", Qt::CaseInsensitive)
-                         || vType[i].startsWith("LABEL=", Qt::CaseInsensitive)) {// TODO see vCard 4.0, m.b. LABEL= points to non-standard?
-                    // non-standart types may be non-latin
-                    QString typeCand = vType[i];
-                    typeCand.remove("TYPE=").remove("LABEL=");
-                    if (!skipDecoding)
-                        typeCand = codec->toUnicode(typeCand.toLocal8Bit());
-                    // Detect and split types, composed as value list (RFC)
-                    if (typeCand.contains(",")) {
-                        QStringList typesAsValueList = typeCand.split(",");
-                        foreach (const QString& vlType, typesAsValueList)
-                            types << vlType;
-                    }
-                    else // one value - it's more fast in most cases
-                        types << typeCand;
-                }
-                else if (vType[i].startsWith("VALUE=", Qt::CaseInsensitive))
-                    // for PHOTO/URI, at least
-                    typeVal = vType[i].mid(QString("VALUE=").length());
-                else if (vType[i].startsWith("X-SYNCMLREF", Qt::CaseInsensitive))
-                    syncMLRef = vType[i].mid(QString("X-SYNCMLREF").length()).toInt();
-                else {
-                    // "TYPE=" can be omitted in some addressbooks
-                    // But it also may be encoding (~~)
-                    if (vType[i].startsWith("QUOTED-PRINTABLE", Qt::CaseInsensitive)
-                            || vType[i].startsWith("BASE64", Qt::CaseInsensitive))
-                        encoding = vType[i];
-                    else {// type, type...
-                        if (skipDecoding)
-                            types << vType[i];
-                        else
-                            types << codec->toUnicode(vType[i].toLocal8Bit());
-                    }
-                }
-            }
-            if ((!types.isEmpty()) && (tag!="TEL")
-                    && (tag!="EMAIL") && (tag!="ADR") && (tag!="PHOTO") && (tag!="IMPP"))
-                errors << QObject::tr("Unexpected TYPE appearance at line %1: tag %2").arg(line+1).arg(tag);
-            // Known tags
-            if (tag=="VERSION")
-                item.version = decodeValue(vValue[0], errors);
-            else if (tag=="FN") {
-                item.fullName = decodeValue(vValue[0], errors);
-                // Name compilation for error messages
-                if (visName.isEmpty() && !item.fullName.isEmpty())
-                    visName = " (" + item.fullName + ")";
-            }
-            else if (tag=="N") {
-                foreach (const QString& name, vValue)
-                    item.names << decodeValue(name, errors);
-                // If empty parts not in-middle, remove it
-                item.dropFinalEmptyNames();
-                // Name compilation for error messages
-                if (visName.isEmpty() && !item.names.isEmpty())
-                    visName = " (" + item.formatNames() + ")";
-            }
-            else if (tag=="NOTE")
-                item.description = decodeValue(vValue[0], errors);
-            else if (tag=="SORT-STRING")
-                item.sortString = decodeValue(vValue[0], errors);
-            else if (tag=="TEL") {
-                Phone phone;
-                phone.value = decodeValue(vValue[0], errors);
-                // Phone type(s)
-                if (types.isEmpty()) {
-                    errors << QObject::tr("Missing phone type at line %1: %2%3").arg(line+1).arg(vValue[0]).arg(visName);
-                    // TODO mb. no type is valid (in this case compare container and contact edit dialog must be updated)
-                    // TODO in this case make warning optional in settings (and, probably, false by default)
-                    phone.types << defaultEmptyPhoneType.toUpper();
-                }
-                else phone.types = types;
-                if (gd.warnOnNonStandardTypes)
-                    foreach(const QString& tType, types) {
-                        bool isStandard;
-                        Phone::standardTypes.translate(tType, &isStandard);
-                        if (!isStandard)
-                            errors << QObject::tr("Non-standard phone type at line %1: %2%3").arg(line+1).arg(tType).arg(visName);
-                    }
-                phone.syncMLRef = syncMLRef;
-                item.phones << phone;
-            }
-            else if (tag=="EMAIL") {
-                // Some phones write empty EMAIL tag even if no email (i.e SE W300i in vCard 2.1)
-                if (vValue[0].isEmpty())
-                    continue;
-                Email email;
-                email.value = decodeValue(vValue[0], errors);
-                if (types.isEmpty()) // maybe, it not a bug; some devices allows email without type
-                    email.types << "pref";
-                else
-                    email.types = types;
-                email.syncMLRef = syncMLRef;
-                item.emails << email;
-            }
-            else if (tag=="BDAY")
-                importDate(item.birthday, decodeValue(vValue[0], errors), errors);
-            else if (tag=="X-ANNIVERSARY") {
-                DateItem di;
-                importDate(di, decodeValue(vValue[0], errors), errors);
-                item.anniversaries.push_back(di);
-            }
-            else if (tag=="PHOTO") {
-                if (typeVal.startsWith("URI", Qt::CaseInsensitive)) {
-                    item.photo.pType = "URL";
-                    item.photo.url = decodeValue(vValue[0], errors);
-                }
-                else {
-                    item.photo.pType = types[0];
-                    if (item.photo.pType.toUpper()!="JPEG" && item.photo.pType.toUpper()!="PNG")
-                        errors << QObject::tr("Unsupported photo type at line %1: %2%3").arg(line+1).arg(typeVal).arg(visName);
-                    if (encoding=="B" || encoding=="BASE64") {
-                        QString binaryData = vValue[0];
-                        while (line<lines.count()-1 && !lines[line+1].trimmed().isEmpty() && lines[line+1].left(1)==" ") {
-                            binaryData += lines[line+1];
-                            line++;
-                        }
-                        if (lines[line+1].trimmed().isEmpty()) line++;
-                        item.photo.data = QByteArray::fromBase64(binaryData.toLatin1());
-                    }
-                    else
-                        errors << QObject::tr("Unknown encoding type at line %1: %2%3").arg(line+1).arg(encoding).arg(visName);
-                }
-            }
-            else if (tag=="ORG")
-                item.organization = decodeValue(vValue[0], errors);
-            else if (tag=="TITLE")
-                item.title = decodeValue(vValue[0], errors);
-            else if (tag=="ADR") {
-                PostalAddress addr;
-                importAddress(addr, types, vValue, errors);
-                if (types.isEmpty())
-                    addr.types << "work";
-                else
-                    addr.types = types;
-                addr.syncMLRef = syncMLRef;
-                item.addrs << addr;
-            }
-            // Internet
-            else if (tag=="NICKNAME")
-                item.nickName = decodeValue(vValue[0], errors);
-            else if (tag=="URL")
-                item.url = decodeValue(vValue[0], errors);
-            else if (tag=="X-JABBER") // Pre-vCard 4.0 non-standard IM tags
-                item.ims << Messenger(vValue[0], "xmpp");
-            else if (tag=="X-ICQ")
-                item.ims << Messenger(vValue[0], "icq");
-            else if (tag=="X-SKYPE-USERNAME")
-                item.ims << Messenger(vValue[0], "skype");
-            else if (tag=="IMPP") { // vCard 4.0
-                Messenger im;
-                im.value = decodeValue(vValue[0], errors);
-                if (types.isEmpty())
-                    im.types << "pref";
-                else
-                    im.types = types;
-                im.syncMLRef = syncMLRef;
-                item.ims << im;
-
-            }
-            // TODO nickname and url also can require x-syncmlref
-            // Identifier
-            else if (tag=="X-IRMC-LUID")
-                item.id = decodeValue(vValue[0], errors);
-            // Known but un-editing tags
-            else if (
-                tag=="LABEL"
-                || tag=="CATEGORIES"// MyPhoneExplorer YES, embedded android export NO
-                || tag=="X-ACCOUNT" // MyPhoneExplorer YES, embedded android export NO
-            )
-            { // TODO other from rfc 2426
-                item.otherTags.push_back(TagValue(vType.join(";"),
-                    decodeValue(vValue.join(";"), errors)));
-            }            
-            // Unknown tags
-            else {
-                item.unknownTags.push_back(TagValue(vType.join(";"),
-                    decodeValue(vValue.join(";"), errors)));
-            }
         }
-
+        else if (recordOpened)
+            importProperty(lines, line, firstLine, *item, visName, errors);
     }
     if (recordOpened) {
-        item.calculateFields();
-        list.push_back(item);
+        item->calculateFields();
         errors << QObject::tr("Last section not closed");
     }
-    // Unknown tags statistics
-    int totalUnknownTags = 0;
-    foreach (const ContactItem& _item, list)
-        totalUnknownTags += _item.unknownTags.count();
-    if (totalUnknownTags)
-        errors << QObject::tr("%1 unknown tags found").arg(totalUnknownTags);
-    // Ready
-    return (!list.isEmpty());
 }
 
 bool VCardData::exportRecords(QStringList &lines, const ContactList &list, QStringList& errors)
@@ -297,7 +115,7 @@ bool VCardData::exportRecords(QStringList &lines, const ContactList &list, QStri
 void VCardData::exportRecord(QStringList &lines, const ContactItem &item, QStringList& errors)
 {
     // Format version
-    formatVersion = gd.preferredVCFVersion;
+    formatVersion = preferredVersion;
     if (useOriginalFileVersion && (item.originalFormat=="VCARD")) {
         if (item.version=="2.1")
             formatVersion = GlobalConfig::VCF21;
@@ -382,7 +200,7 @@ void VCardData::exportRecord(QStringList &lines, const ContactItem &item, QStrin
             else if (!im.types.isEmpty())
                 lines << encodeAll("X-" + im.types.join("+"), 0, false, im.value);
             else
-                errors << S_ERR_UNSUPPORTED_TAG.arg(item.visibleName).arg(S_IM);
+                errors << S_ERR_UNSUPPORTED_TAG.arg(item.visibleName()).arg(S_IM);
         }
     }
     // Identifier
@@ -398,6 +216,321 @@ void VCardData::exportRecord(QStringList &lines, const ContactItem &item, QStrin
     lines << "END:VCARD";
 }
 
+void VCardData::prepareImport()
+{
+    typeCodec = QTextCodec::codecForName("UTF-8"); // non-standart types also may be non-latin
+    defaultEmptyPhoneType = Phone::standardTypes.unTranslate(gd.defaultEmptyPhoneType);
+}
+
+int VCardData::mergeQPLines(QStringList &lines) const
+{
+    int recordCount = 0;
+    for (int i=0; i<lines.count(); i++) {
+        if (i>=lines.count()) break; // need, because count changed inside this cycle
+        if (lines[i].startsWith("BEGIN:VCARD", Qt::CaseInsensitive))
+            recordCount++;
+        else if (lines[i].contains("QUOTED-PRINTABLE", Qt::CaseInsensitive))
+            while (lines[i].right(1)=="=" && i<lines.count()-1) {
+                lines[i].remove(lines[i].length()-1, 1);
+                if (lines[i+1].left(1)=="\t") // Folding by tab, for example in Mozilla Thunderbird VCFs
+                    lines[i+1].remove(0, 1);
+                lines[i] += lines[i+1];
+                lines.removeAt(i+1);
+            }
+    }
+    return recordCount;
+}
+
+void VCardData::importProperty(QStringList &lines, int &line, int firstLine, ContactItem &item, QString &visName, QStringList &errors)
+{
+    const QString& s = lines[line];
+    // Split type:value
+    int scPos = s.indexOf(":");
+    if (scPos==-1) {
+        item.unknownTags.push_back(TagValue(s, ""));
+        return;
+    }
+    VCardProperty prop;
+    parseProperty(s.left(scPos), prop, firstLine+line, errors);
+    QString value = s.mid(scPos+1);
+    // Binary photo may continue on next lines
+    if (prop.kind==pkPhoto && !prop.valueType.startsWith("URI", Qt::CaseInsensitive)
+            && (prop.encoding=="B" || prop.encoding=="BASE64")) {
+        while (line<lines.count()-1 && !lines[line+1].trimmed().isEmpty() && lines[line+1].left(1)==" ") {
+            value += lines[line+1];
+            line++;
+        }
+        if (line<lines.count()-1 && lines[line+1].trimmed().isEmpty()) line++;
+    }
+    importValue(prop, value.split(";"), item, visName, firstLine+line, errors);
+}
+
+VCardData::PropertyKind VCardData::propertyKind(const QString &tag)
+{
+    if (tag=="VERSION")
+        return pkVersion;
+    else if (tag=="FN")
+        return pkFullName;
+    else if (tag=="N")
+        return pkNames;
+    else if (tag=="NOTE")
+        return pkNote;
+    else if (tag=="SORT-STRING")
+        return pkSortString;
+    else if (tag=="TEL")
+        return pkPhone;
+    else if (tag=="EMAIL")
+        return pkEmail;
+    else if (tag=="BDAY")
+        return pkBirthday;
+    else if (tag=="X-ANNIVERSARY")
+        return pkAnniversary;
+    else if (tag=="PHOTO")
+        return pkPhoto;
+    else if (tag=="ORG")
+        return pkOrganization;
+    else if (tag=="TITLE")
+        return pkTitle;
+    else if (tag=="ADR")
+        return pkAddress;
+    // Internet
+    else if (tag=="NICKNAME")
+        return pkNickName;
+    else if (tag=="URL")
+        return pkUrl;
+    else if (tag=="X-JABBER") // Pre-vCard 4.0 non-standard IM tags
+        return pkJabber;
+    else if (tag=="X-ICQ")
+        return pkICQ;
+    else if (tag=="X-SKYPE-USERNAME")
+        return pkSkype;
+    else if (tag=="IMPP") // vCard 4.0
+        return pkIMPP;
+    // TODO nickname and url also can require x-syncmlref
+    // Identifier
+    else if (tag=="X-IRMC-LUID")
+        return pkId;
+    // Known but un-editing tags
+    else if (
+        tag=="LABEL"
+        || tag=="CATEGORIES"// MyPhoneExplorer YES, embedded android export NO
+        || tag=="X-ACCOUNT" // MyPhoneExplorer YES, embedded android export NO
+    ) // TODO other from rfc 2426
+        return pkOther;
+    // Unknown tags
+    else
+        return pkUnknown;
+}
+
+void VCardData::parseProperty(const QString &header, VCardProperty &prop, int line, QStringList &errors)
+{
+    QStringList vType = header.split(";");
+    prop.fullTag = header;
+    prop.tag = vType[0].toUpper();
+    prop.kind = propertyKind(prop.tag);
+    // Encoding, charset, types
+    prop.encoding = "";
+    prop.charSet = "";
+    prop.valueType = ""; // for PHOTO/URI, at least
+    prop.types.clear();
+    prop.syncMLRef = -1;
+    for (int i=1; i<vType.count(); i++) {
+        if (vType[i].startsWith("ENCODING=", Qt::CaseInsensitive))
+            prop.encoding = vType[i].mid(QString("ENCODING=").length()).toUpper();
+        else if (vType[i].startsWith("CHARSET=", Qt::CaseInsensitive))
+            prop.charSet = vType[i].mid(QString("CHARSET=").length());
+        else if (vType[i].startsWith("TYPE=", Qt::CaseInsensitive)
+                 || vType[i].startsWith("LABEL=", Qt::CaseInsensitive)) {// TODO see vCard 4.0, m.b. LABEL= points to non-standard?
+            // non-standart types may be non-latin
+            QString typeCand = vType[i];
+            typeCand.remove("TYPE=").remove("LABEL=");
+            if (!skipDecoding)
+                typeCand = typeCodec->toUnicode(typeCand.toLocal8Bit());
+            // Detect and split types, composed as value list (RFC)
+            if (typeCand.contains(",")) {
+                QStringList typesAsValueList = typeCand.split(",");
+                foreach (const QString& vlType, typesAsValueList)
+                    prop.types << vlType;
+            }
+            else // one value - it's more fast in most cases
+                prop.types << typeCand;
+        }
+        else if (vType[i].startsWith("VALUE=", Qt::CaseInsensitive))
+            // for PHOTO/URI, at least
+            prop.valueType = vType[i].mid(QString("VALUE=").length());
+        else if (vType[i].startsWith("X-SYNCMLREF", Qt::CaseInsensitive))
+            prop.syncMLRef = vType[i].mid(QString("X-SYNCMLREF").length()).toInt();
+        else {
+            // "TYPE=" can be omitted in some addressbooks
+            // But it also may be encoding (~~)
+            if (vType[i].startsWith("QUOTED-PRINTABLE", Qt::CaseInsensitive)
+                    || vType[i].startsWith("BASE64", Qt::CaseInsensitive))
+                prop.encoding = vType[i];
+            else {// type, type...
+                if (skipDecoding)
+                    prop.types << vType[i];
+                else
+                    prop.types << typeCodec->toUnicode(vType[i].toLocal8Bit());
+            }
+        }
+    }
+    if ((!prop.types.isEmpty()) && (prop.kind!=pkPhone)
+            && (prop.kind!=pkEmail) && (prop.kind!=pkAddress) && (prop.kind!=pkPhoto) && (prop.kind!=pkIMPP))
+        errors << QObject::tr("Unexpected TYPE appearance at line %1: tag %2").arg(line+1).arg(prop.tag);
+}
+
+void VCardData::importValue(const VCardProperty &prop, const QStringList &vValue, ContactItem &item, QString &visName, int line, QStringList &errors)
+{
+    // Used by decodeValue()
+    encoding = prop.encoding;
+    charSet = prop.charSet;
+    const QStringList& types = prop.types;
+    switch (prop.kind) {
+    case pkVersion:
+        item.version = decodeValue(vValue[0], errors);
+        break;
+    case pkFullName:
+        item.fullName = decodeValue(vValue[0], errors);
+        // Name compilation for error messages
+        if (visName.isEmpty() && !item.fullName.isEmpty())
+            visName = " (" + item.fullName + ")";
+        break;
+    case pkNames:
+        foreach (const QString& name, vValue)
+            item.names << decodeValue(name, errors);
+        // If empty parts not in-middle, remove it
+        item.dropFinalEmptyNames();
+        // Name compilation for error messages
+        if (visName.isEmpty() && !item.names.isEmpty())
+            visName = " (" + item.formatNames() + ")";
+        break;
+    case pkNote:
+        item.description = decodeValue(vValue[0], errors);
+        break;
+    case pkSortString:
+        item.sortString = decodeValue(vValue[0], errors);
+        break;
+    case pkPhone: {
+        Phone phone;
+        phone.value = decodeValue(vValue[0], errors);
+        // Phone type(s)
+        if (types.isEmpty()) {
+            errors << QObject::tr("Missing phone type at line %1: %2%3").arg(line+1).arg(vValue[0]).arg(visName);
+            // TODO mb. no type is valid (in this case compare container and contact edit dialog must be updated)
+            // TODO in this case make warning optional in settings (and, probably, false by default)
+            phone.types << defaultEmptyPhoneType.toUpper();
+        }
+        else phone.types = types;
+        if (gd.warnOnNonStandardTypes)
+            foreach(const QString& tType, types) {
+                bool isStandard;
+                Phone::standardTypes.translate(tType, &isStandard);
+                if (!isStandard)
+                    errors << QObject::tr("Non-standard phone type at line %1: %2%3").arg(line+1).arg(tType).arg(visName);
+            }
+        phone.syncMLRef = prop.syncMLRef;
+        item.phones << phone;
+        break;
+    }
+    case pkEmail: {
+        // Some phones write empty EMAIL tag even if no email (i.e SE W300i in vCard 2.1)
+        if (vValue[0].isEmpty())
+            return;
+        Email email;
+        email.value = decodeValue(vValue[0], errors);
+        if (types.isEmpty()) // maybe, it not a bug; some devices allows email without type
+            email.types << "pref";
+        else
+            email.types = types;
+        email.syncMLRef = prop.syncMLRef;
+        item.emails << email;
+        break;
+    }
+    case pkBirthday:
+        importDate(item.birthday, decodeValue(vValue[0], errors), errors);
+        break;
+    case pkAnniversary: {
+        DateItem di;
+        importDate(di, decodeValue(vValue[0], errors), errors);
+        item.anniversaries.push_back(di);
+        break;
+    }
+    case pkPhoto:
+        if (prop.valueType.startsWith("URI", Qt::CaseInsensitive)) {
+            item.photo.pType = "URL";
+            item.photo.url = decodeValue(vValue[0], errors);
+        }
+        else {
+            item.photo.pType = types.value(0);
+            if (item.photo.pType.toUpper()!="JPEG" && item.photo.pType.toUpper()!="PNG")
+                errors << QObject::tr("Unsupported photo type at line %1: %2%3").arg(line+1).arg(prop.valueType).arg(visName);
+            if (encoding=="B" || encoding=="BASE64")
+                item.photo.data = QByteArray::fromBase64(vValue[0].toLatin1());
+            else
+                errors << QObject::tr("Unknown encoding type at line %1: %2%3").arg(line+1).arg(encoding).arg(visName);
+        }
+        break;
+    case pkOrganization:
+        item.organization = decodeValue(vValue[0], errors);
+        break;
+    case pkTitle:
+        item.title = decodeValue(vValue[0], errors);
+        break;
+    case pkAddress: {
+        PostalAddress addr;
+        importAddress(addr, types, vValue, errors);
+        if (types.isEmpty())
+            addr.types << "work";
+        else
+            addr.types = types;
+        addr.syncMLRef = prop.syncMLRef;
+        item.addrs << addr;
+        break;
+    }
+    // Internet
+    case pkNickName:
+        item.nickName = decodeValue(vValue[0], errors);
+        break;
+    case pkUrl:
+        item.url = decodeValue(vValue[0], errors);
+        break;
+    case pkJabber:
+        item.ims << Messenger(vValue[0], "xmpp");
+        break;
+    case pkICQ:
+        item.ims << Messenger(vValue[0], "icq");
+        break;
+    case pkSkype:
+        item.ims << Messenger(vValue[0], "skype");
+        break;
+    case pkIMPP: {
+        Messenger im;
+        im.value = decodeValue(vValue[0], errors);
+        if (types.isEmpty())
+            im.types << "pref";
+        else
+            im.types = types;
+        im.syncMLRef = prop.syncMLRef;
+        item.ims << im;
+        break;
+    }
+    // Identifier
+    case pkId:
+        item.id = decodeValue(vValue[0], errors);
+        break;
+    // Known but un-editing tags
+    case pkOther:
+        item.otherTags.push_back(TagValue(prop.fullTag,
+            decodeValue(vValue.join(";"), errors)));
+        break;
+    // Unknown tags
+    default:
+        item.unknownTags.push_back(TagValue(prop.fullTag,
+            decodeValue(vValue.join(";"), errors)));
+        break;
+    }
+}
+
 QString VCardData::decodeValue(const QString &src, QStringList& errors) const
 {
     if (skipDecoding)
@@ -14,6 +14,7 @@
 #define VCARDDATA_H
 
 #include <QStringList>
+#include <QTextCodec>
 #include "../../contactlist.h"
 
 class VCardData
@@ -23,12 +24,46 @@ public:
     bool importRecords(QStringList& lines, ContactList& list, bool append, QStringList& errors);
     bool exportRecords(QStringList& lines, const ContactList& list, QStringList& errors);
     void exportRecord(QStringList& lines, const ContactItem& item, QStringList& errors);
+    // Incremental import, for streaming readers: each portion contains only whole records;
+    // firstLine is line number of portion start, for messages
+    void beginImport(ContactList& list, bool append);
+    void importPortion(QStringList& lines, int firstLine, ContactList& list, QStringList& errors);
+    bool endImport(ContactList& list, QStringList& errors);
 protected:
     bool useOriginalFileVersion, skipEncoding, skipDecoding, forceShortType, forceShortDate;
+    GlobalConfig::VCFVersion preferredVersion; // on export, if original version isn't used
+    // Known properties
+    enum PropertyKind {
+        pkVersion, pkFullName, pkNames, pkNote, pkSortString,
+        pkPhone, pkEmail, pkBirthday, pkAnniversary, pkPhoto,
+        pkOrganization, pkTitle, pkAddress, pkNickName, pkUrl,
+        pkJabber, pkICQ, pkSkype, pkIMPP, pkId,
+        pkOther,  // known but un-editing
+        pkUnknown
+    };
+    // Parsed property name with parameters (part of line before ':')
+    struct VCardProperty {
+        QString fullTag, tag;
+        PropertyKind kind;
+        QString encoding, charSet, valueType;
+        QStringList types;
+        int syncMLRef;
+    };
+    // Property name can be parsed once and applied to many values (i.e. CSV column)
+    void prepareImport();
+    void parseProperty(const QString& header, VCardProperty& prop, int line, QStringList& errors);
+    void importValue(const VCardProperty& prop, const QStringList& vValue, ContactItem& item,
+        QString& visName, int line, QStringList& errors);
 private:
     QString encoding;
     QString charSet;
     GlobalConfig::VCFVersion formatVersion;
+    QTextCodec* typeCodec;
+    QString defaultEmptyPhoneType;
+    int mergeQPLines(QStringList& lines) const;
+    void collectRecords(QStringList& lines, int firstLine, ContactList& list, QStringList& errors);
+    void importProperty(QStringList& lines, int& line, int firstLine, ContactItem& item, QString& visName, QStringList& errors);
+    static PropertyKind propertyKind(const QString& tag);
     QString decodeValue(const QString& src, QStringList& errors) const;
     void importDate(DateItem& item, const QString& src, QStringList& errors) const;
     void importAddress(PostalAddress& item, const QStringList& aTypes, const QStringList& values, QStringList& errors) const;
@@ -13,20 +13,31 @@
 #include <QStringList>
 
 #include <QTextCodec>
+#include <QTextDecoder>
 #include "csvfile.h"
+#include "../profiles/declarativecsvprofile.h"
 #include "../profiles/explaybm50profile.h"
 #include "../profiles/explaytv240profile.h"
 #include "../profiles/genericcsvprofile.h"
 #include "../profiles/osmoprofile.h"
 
+// Size of file chunk, decoded and parsed at once
+#define CSV_BUFFER_SIZE 65536
+// Initial capacity of line buffer for writing
+#define CSV_LINE_RESERVE 1024
+
 CSVFile::CSVFile()
     :FileFormat(), currentProfile(0),
-      _encoding(""), _separator(",")
+      _encoding(""), _separator(),
+      decoder(0), bufferPos(0), skipLF(false)
 {
     profiles << new ExplayBM50Profile;
     profiles << new ExplayTV240Profile;
     profiles << new GenericCSVProfile;
     profiles << new OsmoProfile;
+    // Profiles, described in data files
+    foreach (DeclarativeCSVProfile* profile, DeclarativeCSVProfile::createFileProfiles())
+        profiles << profile;
 }
 
 CSVFile::~CSVFile()
@@ -35,25 +46,22 @@ CSVFile::~CSVFile()
         delete _profile;
 }
 
-bool CSVFile::detect(const QString &url)
+int CSVFile::detect(const FileSniffer &sniffer)
 {
-    QFile f(url);
-    if (!f.open(QIODevice::ReadOnly)) return false;
-    QTextStream stream(&f);
-    QString s1 = stream.readLine();
-    bool res = s1.contains(","); // TODO bad method. M.b. make CSVProfile::detect and call for all profiles
-    f.close();
-    return res;
+    // TODO bad method. M.b. make CSVProfile::detect and call for all profiles
+    if (sniffer.firstLine().contains(","))
+        return FileSniffer::Weak;
+    return FileSniffer::NotDetected;
 }
 
 QStringList CSVFile::supportedExtensions()
 {
-    return (QStringList() << "csv" << "CSV");
+    return (QStringList() << "csv" << "CSV" << "csv.gz" << "CSV.GZ");
 }
 
 QStringList CSVFile::supportedFilters()
 {
-    return (QStringList() << "CSV (*.csv *.CSV)");
+    return (QStringList() << "CSV (*.csv *.CSV *.csv.gz)");
 }
 
 QStringList CSVFile::availableProfiles()
@@ -80,11 +88,16 @@ void CSVFile::setEncoding(const QString &encoding)
     _encoding = encoding;
 }
 
-void CSVFile::setSeparator(const QString &separator)
+void CSVFile::setSeparator(QChar separator)
 {
     _separator = separator;
 }
 
+QChar CSVFile::currentSeparator() const
+{
+    return _separator.isNull() ? currentProfile->separator() : _separator;
+}
+
 QString CSVFile::profile()
 {
     if (currentProfile)
@@ -97,63 +110,171 @@ bool CSVFile::importRecords(const QString &url, ContactList &list, bool append)
 {
     if (!currentProfile)
         return false;
-    if (!openFile(url, QIODevice::ReadOnly))
+    if (!openInput(url, supportedExtensions()))
         return false;
     _errors.clear();
     _errors << "CSV support is very experimental, you can loss your data"; //===>
-    QList<QStringList> rows;
-    QTextStream stream(&file);
     if (_encoding.isEmpty())
         _encoding = currentProfile->charSet();
-    stream.setCodec(_encoding.toLatin1().data());
-    do {
-        QString line = stream.readLine();
-        bool inQuotes = false;
-        QString val = "";
-        QStringList row;
-        foreach(const QChar& c, line.trimmed()) {
-            switch (c.toLatin1()) {
-            case '\"':
-                inQuotes = !inQuotes;
-                break;
-            case ';':
-            case ',':
-                if (!inQuotes) {
-                    row << val;
-                    val.clear();
-                    break;
-                }
-            case 0:
-            default:
-                val += c;
-                break;
-            }
-        }
-        row << val;
-        rows << row;
-    } while (!stream.atEnd());
-    closeFile();
-    int firstLine = currentProfile->hasHeader() ? 1 : 0;
-    if (currentProfile->hasHeader())
-        currentProfile->parseHeader(rows[0]);
+    QTextCodec* codec = QTextCodec::codecForName(_encoding.toLatin1());
+    if (!codec) {
+        _fatalError = QObject::tr("Unknown encoding: %1").arg(_encoding);
+        closeInput();
+        return false;
+    }
+    // BOM, if present, has priority over profile encoding
+    codec = QTextCodec::codecForUtfText(input->peek(4), codec);
+    decoder = codec->makeDecoder();
+    buffer.clear();
+    bufferPos = 0;
+    skipLF = false;
     if (!append)
         list.clear();
-    for (int i=firstLine; i<rows.count(); i++) {
-        ContactItem item;
+    list.originalProfile = currentProfile->name();
+    // Rows are passed to profile as soon as read
+    bool headerRead = !currentProfile->hasHeader();
+    QStringList row;
+    while (readRow(row)) {
+        if (!headerRead) {
+            currentProfile->parseHeader(row);
+            headerRead = true;
+            continue;
+        }
+        list.push_back(ContactItem());
+        ContactItem& item = list.last();
         item.originalFormat = "CSV";
-        list.originalProfile = currentProfile->name();
-        currentProfile->importRecord(rows[i], item, _errors);
+        currentProfile->importRecord(row, item, _errors);
         item.calculateFields();
-        list << item;
     }
-    // For new profiles debug
-    /* std::cout << url.toLocal8Bit().data() << std::endl;
-     std::cout << rows[0].count() << " " << rows[1].count()
-              << "|" << rows[0].last().toLocal8Bit().data() << std::endl; */
+    delete decoder;
+    decoder = 0;
+    buffer.clear();
+    closeInput();
     // Ready
     return (!list.isEmpty());
 }
 
+bool CSVFile::fillBuffer()
+{
+    QByteArray data = input->read(CSV_BUFFER_SIZE);
+    if (data.isEmpty())
+        return false;
+    buffer = decoder->toUnicode(data);
+    bufferPos = 0;
+    return true;
+}
+
+// RFC 4180 reader. Additionally, LF and CR line endings are accepted,
+// empty lines are skipped, and characters after closing quote are kept
+bool CSVFile::readRow(QStringList &row)
+{
+    enum State {
+        FieldStart,
+        Unquoted,
+        Quoted,
+        QuoteInQuoted // closing quote or first quote of "" pair
+    };
+    const QChar sep = currentSeparator();
+    const QChar quote('"');
+    const QChar cr('\r');
+    const QChar lf('\n');
+    State state = FieldStart;
+    bool rowStarted = false;
+    QString cell;
+    row.clear();
+    forever {
+        if (bufferPos>=buffer.length() && !fillBuffer()) {
+            // End of file
+            if (state==Quoted)
+                _errors << QObject::tr("Unterminated quoted value at end of CSV file");
+            if (rowStarted)
+                row << cell;
+            return rowStarted;
+        }
+        const QChar* data = buffer.constData();
+        const int len = buffer.length();
+        while (bufferPos<len) {
+            QChar c = data[bufferPos];
+            if (skipLF) { // second char of CRLF, possibly in next buffer or row
+                skipLF = false;
+                if (c==lf) {
+                    bufferPos++;
+                    continue;
+                }
+            }
+            switch (state) {
+            case FieldStart:
+                if (c==cr || c==lf) {
+                    bufferPos++;
+                    skipLF = (c==cr);
+                    if (rowStarted) {
+                        row << cell;
+                        return true;
+                    }
+                    break; // empty line
+                }
+                rowStarted = true;
+                if (c==quote) {
+                    bufferPos++;
+                    state = Quoted;
+                }
+                else if (c==sep) {
+                    bufferPos++;
+                    row << cell;
+                }
+                else
+                    state = Unquoted;
+                break;
+            case Unquoted:
+            case QuoteInQuoted:
+                if (state==QuoteInQuoted) {
+                    if (c==quote) { // escaped quote
+                        bufferPos++;
+                        cell += quote;
+                        state = Quoted;
+                        break;
+                    }
+                    state = Unquoted;
+                }
+                {
+                    // Scan up to separator or line end
+                    int start = bufferPos;
+                    while (bufferPos<len && data[bufferPos]!=sep
+                           && data[bufferPos]!=cr && data[bufferPos]!=lf)
+                        bufferPos++;
+                    if (bufferPos>start)
+                        cell.append(buffer.midRef(start, bufferPos-start));
+                }
+                if (bufferPos<len) {
+                    c = data[bufferPos++];
+                    row << cell;
+                    cell.clear();
+                    state = FieldStart;
+                    if (c!=sep) { // line end
+                        skipLF = (c==cr);
+                        return true;
+                    }
+                }
+                break;
+            case Quoted:
+                {
+                    // Scan up to quote; separators and line ends are data here
+                    int start = bufferPos;
+                    while (bufferPos<len && data[bufferPos]!=quote)
+                        bufferPos++;
+                    if (bufferPos>start)
+                        cell.append(buffer.midRef(start, bufferPos-start));
+                }
+                if (bufferPos<len) {
+                    bufferPos++;
+                    state = QuoteInQuoted;
+                }
+                break;
+            }
+        }
+    }
+}
+
 bool CSVFile::exportRecords(const QString &url, ContactList &list)
 {
     _errors << "CSV support is very experimental, you can loss your data"; //===>
@@ -161,52 +282,71 @@ bool CSVFile::exportRecords(const QString &url, ContactList &list)
         return false;
     if (!currentProfile->prepareExport(list))
         return false;
-    QList<QStringList> rows;
-    foreach (const ContactItem& item, list) {
-        QStringList row;
-        currentProfile->exportRecord(row, item, _errors);
-        rows << row;
-    }
-    if (!openFile(url, QIODevice::WriteOnly))
+    if (!openSink(url))
         return false;
-    QTextStream stream(&file);
     if (_encoding.isEmpty())
         _encoding = currentProfile->charSet();
-    stream.setCodec(_encoding.toLatin1().data());
-    stream.setGenerateByteOrderMark(currentProfile->hasBOM());
+    sink.setCodec(_encoding.toLatin1().data(), currentProfile->hasBOM());
+    lineBuffer.reserve(CSV_LINE_RESERVE);
     // Header
     if (currentProfile->hasHeader())
-        putLine(stream, currentProfile->makeHeader());
-    // Items
-    foreach (const QStringList& row, rows)
-        putLine(stream, row);
-    closeFile();
-    return true;
+        putLine(currentProfile->makeHeader());
+    // Items are written as soon as profile makes it
+    QStringList row;
+    foreach (const ContactItem& item, list) {
+        row.clear();
+        currentProfile->exportRecord(row, item, _errors);
+        putLine(row);
+    }
+    lineBuffer.clear();
+    return closeSink();
 }
-void CSVFile::putLine(QTextStream& stream, const QStringList &source)
-{
-    // Quoting
-    switch (currentProfile->quotingPolicy()) {
-    case CSVProfileBase::AlwaysQuote:
-        stream << QString("\"%1\"").arg(source.join("\"%1\"").arg(_separator));
-        break;
-    case CSVProfileBase::NeverQuote:
-        stream << source.join(_separator);
-        break;
-    case CSVProfileBase::QuoteIfNeed:
-        QString line;
-        foreach (const QString& cell, source) {
-            if (cell.contains(_separator))
-                line += QString("\"%1\"").arg(cell);
-            else
-                line += cell;
-            line += _separator;
+
+void CSVFile::putLine(const QStringList &source)
+{
+    const QChar sep = currentSeparator();
+    const QChar quote('"');
+    CSVProfileBase::QuotingPolicy policy = currentProfile->quotingPolicy();
+    lineBuffer.resize(0); // keeps reserved capacity
+    for (int i=0; i<source.count(); i++) {
+        const QString& cell = source[i];
+        if (i>0)
+            lineBuffer += sep;
+        // Quoting
+        bool needQuotes;
+        switch (policy) {
+        case CSVProfileBase::AlwaysQuote:
+            needQuotes = true;
+            break;
+        case CSVProfileBase::NeverQuote:
+            needQuotes = false;
+            break;
+        default: // QuoteIfNeed
+            needQuotes = cell.contains(sep) || cell.contains(quote)
+                || cell.contains(QChar('\n')) || cell.contains(QChar('\r'));
+            break;
+        }
+        if (!needQuotes) {
+            lineBuffer += cell;
+            continue;
         }
-        if (line.right(1)==_separator)
-            line.remove(line.length()-1, 1);
+        // RFC 4180: quote inside quoted value is doubled
+        lineBuffer += quote;
+        if (cell.contains(quote)) {
+            foreach (const QChar& c, cell) {
+                if (c==quote)
+                    lineBuffer += quote;
+                lineBuffer += c;
+            }
+        }
+        else
+            lineBuffer += cell;
+        lineBuffer += quote;
     }
     // Line ending
     if (currentProfile->lineEnding()==CSVProfileBase::CRLFEnding)
-        stream << (char)13;
-    stream << endl;
+        lineBuffer += "\r\n";
+    else
+        lineBuffer += "\n";
+    sink << lineBuffer;
 }
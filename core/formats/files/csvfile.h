@@ -15,10 +15,11 @@
 #define CSVFILE_H
 
 #include <QStringList>
-#include <QTextStream>
+#include <QTextDecoder>
 #include <QVector>
 #include "../profiles/csvprofilebase.h"
 #include "fileformat.h"
+#include "filesniffer.h"
 
 class CSVFile : public FileFormat
 {
@@ -27,21 +28,32 @@ public:
     virtual ~CSVFile();
     // IFormat interface
 public:
-    static bool detect(const QString &url);
+    static int detect(const FileSniffer& sniffer);
     static QStringList supportedExtensions();
     static QStringList supportedFilters();
     QStringList availableProfiles();
     bool setProfile(const QString& name);
     void setEncoding(const QString& encoding);
-    void setSeparator(const QString& separator);
+    void setSeparator(QChar separator); // null char means profile separator
     QString profile();
     bool importRecords(const QString &url, ContactList &list, bool append);
     bool exportRecords(const QString &url, ContactList &list);
 private:
     QVector<CSVProfileBase*> profiles;
     CSVProfileBase* currentProfile;
-    QString _encoding, _separator;
-    void putLine(QTextStream& stream, const QStringList& source);
+    QString _encoding;
+    QChar _separator;
+    QChar currentSeparator() const;
+    // Reader state
+    QTextDecoder* decoder;
+    QString buffer;
+    int bufferPos;
+    bool skipLF;
+    bool fillBuffer();
+    bool readRow(QStringList& row);
+    // Writer state
+    QString lineBuffer; // reused for each line
+    void putLine(const QStringList& source);
 };
 
 #endif // CSVFILE_H
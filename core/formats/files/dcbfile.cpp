@@ -0,0 +1,257 @@
+/* Double Contact
+ *
+ * Module: DoubleContact native binary snapshot file export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QObject>
+#include "dcbfile.h"
+
+// File layout: magic, format version, record count, CSV profile,
+// records, MPB extra data. All values are in QDataStream Qt 4.6 encoding.
+// Type lists are stored already sorted (see ContactItem::calculateFields),
+// so the snapshot is loaded without any text parsing or recalculation.
+#define DCB_MAGIC "DCB\x1a"
+#define DCB_MAGIC_LEN 4
+#define DCB_VERSION 1
+#define DCB_STREAM_VERSION QDataStream::Qt_4_6
+// Lower bound of serialized record size (22 length-prefixed fields and date),
+// used to check record count, read from file, before list pre-sizing
+#define DCB_MIN_RECORD_SIZE 64
+
+// Typed items
+template<class T>
+static QDataStream& writeStringItem(QDataStream& s, const T& item)
+{
+    return s << item.types << (qint32)item.syncMLRef << item.value;
+}
+
+template<class T>
+static QDataStream& readStringItem(QDataStream& s, T& item)
+{
+    qint32 syncMLRef;
+    s >> item.types >> syncMLRef >> item.value;
+    item.syncMLRef = syncMLRef;
+    return s;
+}
+
+static QDataStream& operator<<(QDataStream& s, const Phone& item)
+{
+    return writeStringItem(s, item);
+}
+
+static QDataStream& operator>>(QDataStream& s, Phone& item)
+{
+    return readStringItem(s, item);
+}
+
+static QDataStream& operator<<(QDataStream& s, const Email& item)
+{
+    return writeStringItem(s, item);
+}
+
+static QDataStream& operator>>(QDataStream& s, Email& item)
+{
+    return readStringItem(s, item);
+}
+
+static QDataStream& operator<<(QDataStream& s, const Messenger& item)
+{
+    return writeStringItem(s, item);
+}
+
+static QDataStream& operator>>(QDataStream& s, Messenger& item)
+{
+    return readStringItem(s, item);
+}
+
+static QDataStream& operator<<(QDataStream& s, const PostalAddress& item)
+{
+    return s << item.types << (qint32)item.syncMLRef
+        << item.offBox << item.extended << item.street << item.city
+        << item.region << item.postalCode << item.country;
+}
+
+static QDataStream& operator>>(QDataStream& s, PostalAddress& item)
+{
+    qint32 syncMLRef;
+    s >> item.types >> syncMLRef
+        >> item.offBox >> item.extended >> item.street >> item.city
+        >> item.region >> item.postalCode >> item.country;
+    item.syncMLRef = syncMLRef;
+    return s;
+}
+
+// Other structures
+static QDataStream& operator<<(QDataStream& s, const DateItem& item)
+{
+    return s << item.value << item.hasTime << item.hasTimeZone
+        << (qint16)item.zoneHour << (qint16)item.zoneMin;
+}
+
+static QDataStream& operator>>(QDataStream& s, DateItem& item)
+{
+    qint16 zoneHour, zoneMin;
+    s >> item.value >> item.hasTime >> item.hasTimeZone >> zoneHour >> zoneMin;
+    item.zoneHour = zoneHour;
+    item.zoneMin = zoneMin;
+    return s;
+}
+
+static QDataStream& operator<<(QDataStream& s, const TagValue& item)
+{
+    return s << item.tag << item.value;
+}
+
+static QDataStream& operator>>(QDataStream& s, TagValue& item)
+{
+    return s >> item.tag >> item.value;
+}
+
+static QDataStream& operator<<(QDataStream& s, const CallInfo& item)
+{
+    return s << item.cType << item.timeStamp << item.duration << item.number << item.name;
+}
+
+static QDataStream& operator>>(QDataStream& s, CallInfo& item)
+{
+    return s >> item.cType >> item.timeStamp >> item.duration >> item.number >> item.name;
+}
+
+static void writeItem(QDataStream& s, const ContactItem& item)
+{
+    s << item.fullName << item.names << item.phones << item.emails
+      << item.birthday << item.anniversaries << item.sortString << item.description
+      << item.photo.pType << item.photo.data << item.photo.url
+      << item.organization << item.title << item.addrs
+      << item.nickName << item.url << item.ims
+      << item.id << item.originalFormat << item.version << item.subVersion
+      << item.otherTags << item.unknownTags;
+}
+
+static void readItem(QDataStream& s, ContactItem& item)
+{
+    s >> item.fullName >> item.names >> item.phones >> item.emails
+      >> item.birthday >> item.anniversaries >> item.sortString >> item.description
+      >> item.photo.pType >> item.photo.data >> item.photo.url
+      >> item.organization >> item.title >> item.addrs
+      >> item.nickName >> item.url >> item.ims
+      >> item.id >> item.originalFormat >> item.version >> item.subVersion
+      >> item.otherTags >> item.unknownTags;
+}
+
+DCBFile::DCBFile()
+    :FileFormat()
+{
+}
+
+int DCBFile::detect(const FileSniffer &sniffer)
+{
+    if (sniffer.head.startsWith(QByteArray(DCB_MAGIC, DCB_MAGIC_LEN)))
+        return FileSniffer::Exact;
+    return FileSniffer::NotDetected;
+}
+
+QStringList DCBFile::supportedExtensions()
+{
+    return (QStringList() << "dcb" << "DCB");
+}
+
+QStringList DCBFile::supportedFilters()
+{
+    return (QStringList() << "DoubleContact snapshot (*.dcb *.DCB)");
+}
+
+bool DCBFile::importRecords(const QString &url, ContactList &list, bool append)
+{
+    if (!openFile(url, QIODevice::ReadOnly))
+        return false;
+    _errors.clear();
+    // Records are read to separate list, so broken file doesn't leave part of them
+    ContactList items;
+    bool res;
+    // Map entire file into memory, if possible, instead of many small reads
+    uchar* data = file.map(0, file.size());
+    if (data) {
+        QByteArray raw = QByteArray::fromRawData((const char*)data, file.size());
+        QDataStream stream(raw);
+        res = readContent(stream, items);
+        file.unmap(data);
+    }
+    else {
+        QDataStream stream(&file);
+        res = readContent(stream, items);
+    }
+    closeFile();
+    if (!res)
+        return false;
+    if (!append)
+        list.clear();
+    list.appendRecords(items);
+    list.extra = items.extra;
+    list.originalProfile = items.originalProfile;
+    return true;
+}
+
+bool DCBFile::readContent(QDataStream &stream, ContactList &list)
+{
+    stream.setVersion(DCB_STREAM_VERSION);
+    char magic[DCB_MAGIC_LEN];
+    if (stream.readRawData(magic, DCB_MAGIC_LEN)!=DCB_MAGIC_LEN
+            || QByteArray(magic, DCB_MAGIC_LEN)!=QByteArray(DCB_MAGIC, DCB_MAGIC_LEN)) {
+        _fatalError = QObject::tr("File isn't DCB file or corrupted");
+        return false;
+    }
+    quint32 version, count;
+    stream >> version;
+    if (version>DCB_VERSION) {
+        _fatalError = QObject::tr("Unsupported DCB file version: %1").arg(version);
+        return false;
+    }
+    stream >> count >> list.originalProfile;
+    // Count isn't trusted: list is pre-sized only as far as remaining data allows
+    QIODevice* dev = stream.device();
+    if (!dev->isSequential())
+        list.reserveRecords((int)qMin((qint64)count, (dev->size()-dev->pos())/DCB_MIN_RECORD_SIZE));
+    for (quint32 i=0; i<count && stream.status()==QDataStream::Ok; i++) {
+        list.push_back(ContactItem());
+        readItem(stream, list.last());
+    }
+    MPBExtra& extra = list.extra;
+    stream >> extra.model >> extra.timeStamp
+        >> extra.editLines(MPBExtra::secOrganizer) >> extra.editLines(MPBExtra::secNotes)
+        >> extra.editLines(MPBExtra::secSMS) >> extra.editLines(MPBExtra::secSMSArchive)
+        >> extra.editCalls();
+    if (stream.status()!=QDataStream::Ok) {
+        _fatalError = QObject::tr("File isn't DCB file or corrupted");
+        return false;
+    }
+    return true;
+}
+
+bool DCBFile::exportRecords(const QString &url, ContactList &list)
+{
+    if (!openSink(url))
+        return false;
+    _errors.clear();
+    QDataStream stream(sink.device());
+    stream.setVersion(DCB_STREAM_VERSION);
+    stream.writeRawData(DCB_MAGIC, DCB_MAGIC_LEN);
+    stream << (quint32)DCB_VERSION << (quint32)list.count() << list.originalProfile;
+    foreach (const ContactItem& item, list)
+        writeItem(stream, item);
+    const MPBExtra& extra = list.extra;
+    stream << extra.model << extra.timeStamp
+        << extra.lines(MPBExtra::secOrganizer) << extra.lines(MPBExtra::secNotes)
+        << extra.lines(MPBExtra::secSMS) << extra.lines(MPBExtra::secSMSArchive)
+        << extra.calls();
+    _errors << list.extra.takeDecodeErrors();
+    return closeSink();
+}
@@ -0,0 +1,36 @@
+/* Double Contact
+ *
+ * Module: DoubleContact native binary snapshot file export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef DCBFILE_H
+#define DCBFILE_H
+
+#include <QDataStream>
+#include "fileformat.h"
+#include "filesniffer.h"
+
+class DCBFile : public FileFormat
+{
+public:
+    DCBFile();
+    // IFormat interface
+public:
+    static int detect(const FileSniffer& sniffer);
+    static QStringList supportedExtensions();
+    static QStringList supportedFilters();
+    bool importRecords(const QString &url, ContactList &list, bool append);
+    bool exportRecords(const QString &url, ContactList &list);
+private:
+    bool readContent(QDataStream& stream, ContactList &list);
+};
+
+#endif // DCBFILE_H
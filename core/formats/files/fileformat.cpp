@@ -11,16 +11,26 @@
  *
  */
 
+#include <QCoreApplication>
 #include <QObject>
 
 #include "fileformat.h"
 #include "globals.h"
+#include "quagzipfile.h"
+#include "quazip.h"
+#include "quazipfile.h"
+
+#define GZIP_MAGIC "\x1f\x8b"
+#define ZIP_MAGIC "PK\x03\x04"
 
 FileFormat::FileFormat()
+    :input(0), gzipInput(0), zipInput(0), zipEntryInput(0)
 {}
 
 FileFormat::~FileFormat()
-{}
+{
+    closeInput();
+}
 
 QStringList FileFormat::errors()
 {
@@ -34,8 +44,13 @@ QString FileFormat::fatalError()
 
 bool FileFormat::openFile(QString path, QIODevice::OpenMode mode)
 {
-    file.setFileName(path);
-    bool res = file.open(mode);
+    bool res;
+    if (path==STD_STREAM_PATH && mode==QIODevice::ReadOnly)
+        res = file.open(stdin, mode); // sequential; stdin isn't closed by closeFile()
+    else {
+        file.setFileName(path);
+        res = file.open(mode);
+    }
     if (!res)
         _fatalError = ((mode==QIODevice::ReadOnly) ? S_READ_ERR : S_WRITE_ERR).arg(path);
     return res;
@@ -47,6 +62,121 @@ void FileFormat::closeFile()
         file.close();
 }
 
+bool FileFormat::openInput(const QString &path, const QStringList &entryExtensions)
+{
+    closeInput();
+    if (!openFile(path, QIODevice::ReadOnly))
+        return false;
+    QByteArray magic = file.peek(4);
+    // Archives are opened by name, so standard input must be decompressed before
+    if (path==STD_STREAM_PATH && (magic.startsWith(GZIP_MAGIC) || magic.startsWith(ZIP_MAGIC))) {
+        _fatalError = QObject::tr("Compressed data can't be read from standard input");
+        closeFile();
+        return false;
+    }
+    if (magic.startsWith(GZIP_MAGIC)) {
+        // Streaming decompression, without temporary file
+        closeFile();
+        gzipInput = new QuaGzipFile(path);
+        if (!gzipInput->open(QIODevice::ReadOnly)) {
+            _fatalError = S_READ_ERR.arg(path);
+            closeInput();
+            return false;
+        }
+        input = gzipInput;
+    }
+    else if (magic.startsWith(ZIP_MAGIC)) {
+        closeFile();
+        zipInput = new QuaZip(path);
+        if (!zipInput->open(QuaZip::mdUnzip)) {
+            _fatalError = S_READ_ERR.arg(path);
+            closeInput();
+            return false;
+        }
+        bool found = false;
+        for (bool more=zipInput->goToFirstFile(); more; more=zipInput->goToNextFile()) {
+            QString name = zipInput->getCurrentFileName();
+            found = !name.endsWith('/')
+                && entryExtensions.contains(name.section('.', -1), Qt::CaseInsensitive);
+            if (found) // it's current file now
+                break;
+        }
+        if (!found) {
+            _fatalError = QObject::tr("Archive not contains %1 files:\n%2")
+                .arg(entryExtensions.isEmpty() ? "" : entryExtensions.first()).arg(path);
+            closeInput();
+            return false;
+        }
+        zipEntryInput = new QuaZipFile(zipInput);
+        if (!zipEntryInput->open(QIODevice::ReadOnly)) {
+            _fatalError = S_READ_ERR.arg(path);
+            closeInput();
+            return false;
+        }
+        input = zipEntryInput;
+    }
+    else
+        input = &file;
+    return true;
+}
+
+void FileFormat::closeInput()
+{
+    if (zipEntryInput) {
+        if (zipEntryInput->isOpen())
+            zipEntryInput->close();
+        delete zipEntryInput;
+        zipEntryInput = 0;
+    }
+    if (zipInput) {
+        if (zipInput->isOpen())
+            zipInput->close();
+        delete zipInput;
+        zipInput = 0;
+    }
+    if (gzipInput) {
+        if (gzipInput->isOpen())
+            gzipInput->close();
+        delete gzipInput;
+        gzipInput = 0;
+    }
+    closeFile();
+    input = 0;
+}
+
+bool FileFormat::openSink(const QString &path)
+{
+    bool res = sink.open(path);
+    if (!res)
+        _fatalError = S_WRITE_ERR.arg(path);
+    return res;
+}
+
+bool FileFormat::closeSink()
+{
+    QString path = sink.fileName();
+    bool res = sink.commit();
+    if (!res)
+        _fatalError = S_WRITE_ERR.arg(path);
+    return res;
+}
+
+int FileFormat::jobChunkSize(int itemCount, int minJobItems)
+{
+    if (inWorkerThread())
+        return qMax(itemCount, 1);
+    int jobCount = qMin(QThread::idealThreadCount(), (itemCount+minJobItems-1)/minJobItems);
+    if (jobCount<1)
+        jobCount = 1;
+    return qMax((itemCount+jobCount-1)/jobCount, 1);
+}
+
+bool FileFormat::inWorkerThread()
+{
+    QCoreApplication* app = QCoreApplication::instance();
+    return app && QThread::currentThread()!=app->thread();
+}
+
 void FileFormat::lossData(QStringList &errors, const QString &contactName, const QString &fieldName, bool condition)
 {
     if (condition)
@@ -15,7 +15,15 @@
 #define FILEFORMAT_H
 
 #include <QFile>
+#include <QList>
+#include <QThread>
+#include <QThreadPool>
 #include "../iformat.h"
+#include "outputsink.h"
+
+class QuaGzipFile;
+class QuaZip;
+class QuaZipFile;
 
 class FileFormat : public IFormat
 {
@@ -28,12 +36,51 @@ public:
         const QString& fieldName, bool condition);
     static void lossData(QStringList& errors, const QString& contactName,
         const QString& fieldName, const QString& field);
+    // Parallel processing: items are split on contiguous ranges,
+    // jobs (QRunnable with autoDelete off) run in thread pool.
+    // Format, used in worker thread (i.e. contconv batch job), runs
+    // its jobs inline, so nested pools don't multiply thread count
+    static int jobChunkSize(int itemCount, int minJobItems);
+    static bool inWorkerThread();
+    template<class T>
+    static void runJobs(const QList<T*>& jobs);
 protected:
     QFile file;
     QStringList _errors;
     QString _fatalError;
     bool openFile(QString path, QIODevice::OpenMode mode);
     void closeFile();
+    // Input of importers: plain file or, if file is gzip or zip archive,
+    // decompressed stream (for zip, first entry with one of given extensions)
+    QIODevice* input;
+    bool openInput(const QString& path, const QStringList& entryExtensions);
+    void closeInput();
+    // Output of exporters; target file is replaced only in closeSink()
+    OutputSink sink;
+    bool openSink(const QString& path);
+    bool closeSink();
+private:
+    QuaGzipFile* gzipInput;
+    QuaZip* zipInput;
+    QuaZipFile* zipEntryInput;
 };
 
+template<class T>
+void FileFormat::runJobs(const QList<T*>& jobs)
+{
+    if (jobs.count()==1) // don't start threads for small data
+        jobs.first()->run();
+    else if (inWorkerThread()) {
+        foreach (T* job, jobs)
+            job->run();
+    }
+    else if (jobs.count()>1) {
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMin(jobs.count(), QThread::idealThreadCount()));
+        foreach (T* job, jobs)
+            pool.start(job);
+        pool.waitForDone();
+    }
+}
+
 #endif // FILEFORMAT_H
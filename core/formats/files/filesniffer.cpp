@@ -0,0 +1,126 @@
+/* Double Contact
+ *
+ * Module: File content sniffing for format detection
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QFile>
+#include <QTextStream>
+#include "filesniffer.h"
+#include "quagzipfile.h"
+#include "quazip.h"
+#include "quazipfile.h"
+
+// Zip end of central directory record (without comment) and central directory file header
+#define ZIP_EOCD_SIGN "PK\x05\x06"
+#define ZIP_EOCD_SIZE 22
+#define ZIP_MAX_COMMENT 65535
+#define ZIP_CDFH_SIGN "PK\x01\x02"
+#define ZIP_CDFH_SIZE 46
+
+static quint32 readLE(const QByteArray& data, int pos, int size)
+{
+    quint32 res = 0;
+    for (int i=size-1; i>=0; i--)
+        res = (res << 8) | (uchar)data[pos+i];
+    return res;
+}
+
+FileSniffer::FileSniffer(const QString &url)
+    :url(url), isReadable(false), isGzip(false), isZip(false), zipDirRead(false)
+{
+    QFile file(url);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    isReadable = true;
+    head = file.read(SNIFF_HEAD_SIZE);
+    isGzip = head.startsWith("\x1f\x8b");
+    isZip = head.startsWith("PK\x03\x04") || head.startsWith(ZIP_EOCD_SIGN);
+    if (isZip)
+        readZipDir(file);
+    file.close();
+    if (isGzip)
+        readGzipHead();
+    else if (isZip)
+        readZipHead();
+}
+
+QString FileSniffer::firstLine() const
+{
+    QTextStream stream(head);
+    return stream.readLine();
+}
+
+bool FileSniffer::zipHasDir(const QString &path) const
+{
+    QString prefix = path + "/";
+    foreach (const QString& entry, zipEntries)
+        if (entry.startsWith(prefix))
+            return true;
+    return false;
+}
+
+void FileSniffer::readGzipHead()
+{
+    QuaGzipFile gz(url);
+    if (gz.open(QIODevice::ReadOnly)) {
+        head = gz.read(SNIFF_HEAD_SIZE);
+        gz.close();
+    }
+}
+
+void FileSniffer::readZipHead()
+{
+    QuaZip zip(url);
+    if (!zip.open(QuaZip::mdUnzip))
+        return;
+    for (bool more=zip.goToFirstFile(); more; more=zip.goToNextFile()) {
+        if (zip.getCurrentFileName().endsWith('/')) // directory
+            continue;
+        QuaZipFile entry(&zip);
+        if (entry.open(QIODevice::ReadOnly)) {
+            head = entry.read(SNIFF_HEAD_SIZE);
+            entry.close();
+        }
+        break;
+    }
+    zip.close();
+}
+
+void FileSniffer::readZipDir(QFile &file)
+{
+    // End of central directory is at file end, after optional comment
+    qint64 tailSize = qMin(file.size(), (qint64)(ZIP_EOCD_SIZE+ZIP_MAX_COMMENT));
+    if (tailSize<ZIP_EOCD_SIZE || !file.seek(file.size()-tailSize))
+        return;
+    QByteArray tail = file.read(tailSize);
+    int eocdPos = tail.lastIndexOf(ZIP_EOCD_SIGN);
+    if (eocdPos==-1 || eocdPos+ZIP_EOCD_SIZE>tail.size())
+        return;
+    quint32 dirSize = readLE(tail, eocdPos+12, 4);
+    quint32 dirOffset = readLE(tail, eocdPos+16, 4);
+    // Zip64 archives (0xffffffff offset) are not parsed here
+    if ((qint64)dirOffset+dirSize>file.size() || !file.seek(dirOffset))
+        return;
+    QByteArray dir = file.read(dirSize);
+    if ((quint32)dir.size()!=dirSize)
+        return;
+    int pos = 0;
+    while (pos+ZIP_CDFH_SIZE<=dir.size() && dir.mid(pos, 4)==ZIP_CDFH_SIGN) {
+        int nameLen = readLE(dir, pos+28, 2);
+        int extraLen = readLE(dir, pos+30, 2);
+        int commentLen = readLE(dir, pos+32, 2);
+        if (pos+ZIP_CDFH_SIZE+nameLen>dir.size())
+            return;
+        zipEntries << QString::fromLocal8Bit(dir.constData()+pos+ZIP_CDFH_SIZE, nameLen);
+        pos += ZIP_CDFH_SIZE+nameLen+extraLen+commentLen;
+    }
+    zipDirRead = true;
+}
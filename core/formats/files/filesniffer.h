@@ -0,0 +1,57 @@
+/* Double Contact
+ *
+ * Module: File content sniffing for format detection
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef FILESNIFFER_H
+#define FILESNIFFER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Max size of file beginning, read for format detection
+#define SNIFF_HEAD_SIZE 65536
+
+class QFile;
+
+// File beginning (and zip central directory, if file is zip archive),
+// read once and shared by detect() methods of all file formats
+class FileSniffer
+{
+public:
+    // Detection confidence levels, returned by detect() methods
+    enum Confidence {
+        NotDetected = 0,
+        Weak = 10,    // heuristic, i.e. comma in first line
+        Likely = 50,
+        Sure = 90,    // format-specific first line or root tag
+        Exact = 100   // binary signature
+    };
+    FileSniffer(const QString& url);
+    QString url;
+    bool isReadable;
+    QByteArray head; // file beginning, up to SNIFF_HEAD_SIZE bytes
+    // For compressed files, head contains beginning of decompressed data
+    // (for zip, of first file entry)
+    bool isGzip;
+    bool isZip;
+    bool zipDirRead; // false if zip central directory was not found or not parsed
+    QStringList zipEntries;
+    QString firstLine() const; // first text line, decoded as by QTextStream
+    bool zipHasDir(const QString& path) const;
+private:
+    void readZipDir(QFile& file);
+    void readGzipHead();
+    void readZipHead();
+};
+
+#endif // FILESNIFFER_H
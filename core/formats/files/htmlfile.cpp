@@ -35,68 +35,68 @@ bool HTMLFile::importRecords(const QString &, ContactList &, bool)
 
 bool HTMLFile::exportRecords(const QString &url, ContactList &list)
 {
-    if (!openFile(url, QIODevice::WriteOnly))
+    if (!openSink(url))
         return false;
     _errors.clear();
-    QTextStream stream(&file);
-    stream.setCodec("UTF-8");
-    stream << QString("<html><head>\n<meta charset=\"utf-8\">\n<title>%1</title>\n</head>\n<body>").arg(url) << endl;
+    sink.setCodec("UTF-8");
+    sink << QString("<html><head>\n<meta charset=\"utf-8\">\n<title>%1</title>\n</head>\n<body>").arg(url);
+    sink.endLine();
     // General data
-    stream << QString("<b>%1</b>: %2<br/>\n").arg(S_ADDRESS_BOOK).arg(url);
+    sink << QString("<b>%1</b>: %2<br/>\n").arg(S_ADDRESS_BOOK).arg(url);
     if (!list.extra.model.isEmpty())
-        stream << QString("%1<br/>\n").arg(list.extra.model);
+        sink << QString("%1<br/>\n").arg(list.extra.model);
     if (!list.extra.timeStamp.isEmpty())
-        stream << QString("%1<br/>\n").arg(list.extra.timeStamp);
-    stream << endl;
+        sink << QString("%1<br/>\n").arg(list.extra.timeStamp);
+    sink.endLine();
     foreach (const ContactItem& item, list) {
-        stream << QString("<p>\n");
+        sink << QString("<p>\n");
         // Name
-        stream << QString("<b>%1</b>\n").arg(item.formatNames());
+        sink << QString("<b>%1</b>\n").arg(item.formatNames());
         // Phone(s), email(s)
-        exportTypedItems(stream, item.phones, S_PHONE);
-        exportTypedItems(stream, item.emails, S_EMAIL);
+        exportTypedItems(sink, item.phones, S_PHONE);
+        exportTypedItems(sink, item.emails, S_EMAIL);
         // Birthday, anniversary
-        exportStringableItem(stream, item.birthday, S_BDAY);
+        exportStringableItem(sink, item.birthday, S_BDAY);
         if (!item.anniversaries.isEmpty()) // TODO simplify, if one ann. will (vCard 4.0)
-            exportStringableItem(stream, item.anniversaries[0], S_ANN);
-        exportString(stream, item.description, S_DESC);
+            exportStringableItem(sink, item.anniversaries[0], S_ANN);
+        exportString(sink, item.description, S_DESC);
         if (!item.photo.isEmpty())
-            exportString(stream, " ", S_HAS_PHOTO); // space, not empty string!
+            exportString(sink, " ", S_HAS_PHOTO); // space, not empty string!
         // Work
-        exportString(stream, item.organization, S_ORG);
-        exportString(stream, item.title, S_TITLE);
+        exportString(sink, item.organization, S_ORG);
+        exportString(sink, item.title, S_TITLE);
         // Addresses
-        exportTypedItems(stream, item.addrs, S_ADDR);
+        exportTypedItems(sink, item.addrs, S_ADDR);
         // Internet
-        exportString(stream, item.nickName, S_NICK);
-        exportString(stream, item.url, S_URL);
-        exportTypedItems(stream, item.ims, S_IM);
-        stream << QString("</p>\n\n");
+        exportString(sink, item.nickName, S_NICK);
+        exportString(sink, item.url, S_URL);
+        exportTypedItems(sink, item.ims, S_IM);
+        sink << QString("</p>\n\n");
     }
     // TODO hr and summary here
-    stream << "\n<body>\n<html>" << endl;
-    closeFile();
-    return true;
+    sink << "\n<body>\n<html>";
+    sink.endLine();
+    return closeSink();
 }
 
-void HTMLFile::exportString(QTextStream &stream, const QString &field, const QString &title)
+void HTMLFile::exportString(OutputSink &out, const QString &field, const QString &title)
 {
     if (!field.isEmpty())
-            stream << QString("<br/><b>%1:</b> %2\n").arg(title).arg(field);
+            out << QString("<br/><b>%1:</b> %2\n").arg(title).arg(field);
 }
 
 template <class T>
-void HTMLFile::exportStringableItem(QTextStream &stream, const T& field, const QString &title)
+void HTMLFile::exportStringableItem(OutputSink &out, const T& field, const QString &title)
 {
     if (!field.isEmpty())
-        exportString(stream, field.toString(), title);
+        exportString(out, field.toString(), title);
 }
 
 template <class T>
-void HTMLFile::exportTypedItems(QTextStream &stream, const QList<T> &lst, const QString& title)
+void HTMLFile::exportTypedItems(OutputSink &out, const QList<T> &lst, const QString& title)
 {
     if (!lst.isEmpty()) {
-        stream << QString("<br/><b>%1:</b> ").arg(title);
+        out << QString("<br/><b>%1:</b> ").arg(title);
         int i=0;
         foreach (const T& it, lst) {
             QString types = "";
@@ -105,11 +105,11 @@ void HTMLFile::exportTypedItems(QTextStream &stream, const QList<T> &lst, const
                 if (j<it.types.count()-1)
                     types += "+";
             }
-            stream << QString("%1 (%2)").arg(it.toString(true)).arg(types);
+            out << QString("%1 (%2)").arg(it.toString(true)).arg(types);
             i++;
             if (i<lst.count())
-                stream << ", ";
+                out << ", ";
         }
-        stream << endl;
+        out.endLine();
     }
 }
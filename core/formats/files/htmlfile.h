@@ -15,7 +15,6 @@
 #define HTMLFILE_H
 
 #include <QList>
-#include <QTextStream>
 #include "fileformat.h"
 
 class HTMLFile : public FileFormat
@@ -30,11 +29,11 @@ public:
     virtual bool importRecords(const QString &, ContactList &, bool);
     virtual bool exportRecords(const QString &url, ContactList &list);
 private:
-    void exportString(QTextStream& stream, const QString& field, const QString& title);
+    void exportString(OutputSink& out, const QString& field, const QString& title);
     template <class T>
-    void exportStringableItem(QTextStream& stream, const T& field, const QString& title);
+    void exportStringableItem(OutputSink& out, const T& field, const QString& title);
     template <class T>
-    void exportTypedItems(QTextStream& stream, const QList<T>& lst, const QString& title);
+    void exportTypedItems(OutputSink& out, const QList<T>& lst, const QString& title);
 };
 
 #endif // HTMLFILE_H
@@ -0,0 +1,552 @@
+/* Double Contact
+ *
+ * Module: jCard (RFC 7095, JSON vCard) file export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QObject>
+#include <QTextCodec>
+#include "jcardfile.h"
+
+// Size of raw data, decoded at once
+#define JCARD_BUFFER_SIZE 65536
+// Card is 4 levels deep; limit protects stack from corrupted files
+#define JCARD_MAX_DEPTH 32
+
+JCardFile::JCardFile()
+    :FileFormat(), VCardData(), decoder(0), bufferPos(0), charPos(0)
+{
+    // jCard is vCard 4.0 in JSON; values are Unicode, without any encoding
+    preferredVersion = GlobalConfig::VCF40;
+    useOriginalFileVersion = false;
+    skipEncoding = true;
+    skipDecoding = true;
+}
+
+JCardFile::~JCardFile()
+{
+    delete decoder;
+}
+
+int JCardFile::detect(const FileSniffer &sniffer)
+{
+    // Single card ["vcard",[...]] or array of cards [["vcard",[...]],...]
+    QString start = QString::fromUtf8(sniffer.head.left(256)).simplified().remove(' ');
+    if (start.startsWith("[\"vcard\"", Qt::CaseInsensitive)
+            || start.startsWith("[[\"vcard\"", Qt::CaseInsensitive))
+        return FileSniffer::Sure;
+    return FileSniffer::NotDetected;
+}
+
+QStringList JCardFile::supportedExtensions()
+{
+    return (QStringList() << "jcard" << "JCARD" << "json" << "JSON");
+}
+
+QStringList JCardFile::supportedFilters()
+{
+    return (QStringList() << "jCard (*.jcard *.JCARD *.json *.JSON)");
+}
+
+bool JCardFile::importRecords(const QString &url, ContactList &list, bool append)
+{
+    if (!openInput(url, supportedExtensions()))
+        return false;
+    _errors.clear();
+    // RFC 7159 allows UTF-16 and UTF-32 too
+    QTextCodec* codec = QTextCodec::codecForUtfText(input->peek(4), QTextCodec::codecForName("UTF-8"));
+    delete decoder;
+    decoder = codec->makeDecoder();
+    buffer.clear();
+    bufferPos = 0;
+    charPos = 0;
+    syntaxError.clear();
+    if (!append)
+        list.clear();
+    prepareImport();
+    // Top-level array is read element by element; only one card is in memory
+    bool res = expectChar('[');
+    bool singleCard = false;
+    for (bool first=true; res; first=false) {
+        QChar c;
+        if (first && peekChar(c) && c==']') {
+            skipChar();
+            break;
+        }
+        QVariant value;
+        res = readValue(value, 0);
+        if (!res)
+            break;
+        if (first && value.userType()==QMetaType::QString && value.toString()=="vcard")
+            singleCard = true; // next element is property list
+        else if (singleCard)
+            importCard(value.toList(), list);
+        else {
+            QVariantList card = value.toList();
+            if (card.count()==2 && card[0].toString()=="vcard")
+                importCard(card[1].toList(), list);
+            else
+                _errors << QObject::tr("Array element at position %1 is not jCard").arg(charPos);
+        }
+        res = peekChar(c);
+        if (res && c==',')
+            skipChar();
+        else if (res && c==']') {
+            skipChar();
+            break;
+        }
+        else {
+            syntaxError = QObject::tr("',' or ']' expected at position %1").arg(charPos);
+            res = false;
+        }
+    }
+    delete decoder;
+    decoder = 0;
+    buffer.clear();
+    closeInput();
+    if (!res) {
+        _fatalError = syntaxError.isEmpty()
+            ? QObject::tr("Unexpected end of file") : syntaxError;
+        return false;
+    }
+    // Ready
+    return (!list.isEmpty());
+}
+
+bool JCardFile::fillBuffer()
+{
+    QByteArray data = input->read(JCARD_BUFFER_SIZE);
+    if (data.isEmpty())
+        return false;
+    buffer = decoder->toUnicode(data);
+    bufferPos = 0;
+    return true;
+}
+
+bool JCardFile::nextChar(QChar &c)
+{
+    if (bufferPos>=buffer.length() && !fillBuffer())
+        return false;
+    c = buffer[bufferPos];
+    skipChar();
+    return true;
+}
+
+bool JCardFile::peekChar(QChar &c)
+{
+    forever {
+        if (bufferPos>=buffer.length() && !fillBuffer())
+            return false;
+        c = buffer[bufferPos];
+        if (!c.isSpace())
+            return true;
+        skipChar();
+    }
+}
+
+void JCardFile::skipChar()
+{
+    bufferPos++;
+    charPos++;
+}
+
+bool JCardFile::expectChar(char c)
+{
+    QChar found;
+    if (peekChar(found) && found==QLatin1Char(c)) {
+        skipChar();
+        return true;
+    }
+    syntaxError = QObject::tr("'%1' expected at position %2").arg(c).arg(charPos);
+    return false;
+}
+
+bool JCardFile::readValue(QVariant &value, int depth)
+{
+    if (depth>JCARD_MAX_DEPTH) {
+        syntaxError = QObject::tr("Too deep nesting at position %1").arg(charPos);
+        return false;
+    }
+    QChar c;
+    if (!peekChar(c))
+        return false;
+    if (c=='[') {
+        skipChar();
+        QVariantList items;
+        if (peekChar(c) && c==']') {
+            skipChar();
+            value = items;
+            return true;
+        }
+        forever {
+            QVariant item;
+            if (!readValue(item, depth+1))
+                return false;
+            items << item;
+            if (!peekChar(c))
+                return false;
+            skipChar();
+            if (c==']')
+                break;
+            if (c!=',') {
+                syntaxError = QObject::tr("',' or ']' expected at position %1").arg(charPos);
+                return false;
+            }
+        }
+        value = items;
+        return true;
+    }
+    if (c=='{') {
+        skipChar();
+        QVariantMap members;
+        if (peekChar(c) && c=='}') {
+            skipChar();
+            value = members;
+            return true;
+        }
+        forever {
+            QString key;
+            QVariant member;
+            if (!peekChar(c))
+                return false;
+            if (c!='"') {
+                syntaxError = QObject::tr("Member name expected at position %1").arg(charPos);
+                return false;
+            }
+            if (!readString(key) || !expectChar(':') || !readValue(member, depth+1))
+                return false;
+            members.insert(key, member);
+            if (!peekChar(c))
+                return false;
+            skipChar();
+            if (c=='}')
+                break;
+            if (c!=',') {
+                syntaxError = QObject::tr("',' or '}' expected at position %1").arg(charPos);
+                return false;
+            }
+        }
+        value = members;
+        return true;
+    }
+    QString s;
+    if (c=='"') {
+        if (!readString(s))
+            return false;
+        value = s;
+        return true;
+    }
+    if (!readLiteral(s))
+        return false;
+    if (s=="null")
+        value = QVariant();
+    else
+        value = s;
+    return true;
+}
+
+bool JCardFile::readString(QString &s)
+{
+    skipChar(); // opening quote
+    s.clear();
+    forever {
+        if (bufferPos>=buffer.length() && !fillBuffer()) {
+            syntaxError = QObject::tr("Unterminated string at end of file");
+            return false;
+        }
+        // Plain characters are copied by chunks
+        const QChar* data = buffer.constData();
+        const int len = buffer.length();
+        const int start = bufferPos;
+        while (bufferPos<len && data[bufferPos]!='"' && data[bufferPos]!='\\')
+            bufferPos++;
+        charPos += bufferPos-start;
+        if (bufferPos>start)
+            s += QString(data+start, bufferPos-start);
+        if (bufferPos>=len)
+            continue;
+        QChar c = data[bufferPos];
+        skipChar();
+        if (c=='"')
+            return true;
+        // Escape sequence
+        if (!nextChar(c))
+            continue; // error on next iteration
+        switch (c.unicode()) {
+        case 'b':
+            s += QChar('\b');
+            break;
+        case 'f':
+            s += QChar('\f');
+            break;
+        case 'n':
+            s += QChar('\n');
+            break;
+        case 'r':
+            s += QChar('\r');
+            break;
+        case 't':
+            s += QChar('\t');
+            break;
+        case 'u': { // surrogate pairs are combined in QString itself
+            QString hex;
+            for (int i=0; i<4 && nextChar(c); i++)
+                hex += c;
+            bool ok;
+            ushort code = hex.toUShort(&ok, 16);
+            if (!ok || hex.length()<4) {
+                syntaxError = QObject::tr("Invalid \\u escape at position %1").arg(charPos);
+                return false;
+            }
+            s += QChar(code);
+            break;
+        }
+        default: // '"', '\\', '/'
+            s += c;
+            break;
+        }
+    }
+}
+
+bool JCardFile::readLiteral(QString &s)
+{
+    s.clear();
+    forever {
+        if (bufferPos>=buffer.length() && !fillBuffer())
+            break;
+        QChar c = buffer[bufferPos];
+        if (!c.isLetterOrNumber() && c!='-' && c!='+' && c!='.')
+            break;
+        s += c;
+        skipChar();
+    }
+    if (s.isEmpty() || !(s[0].isDigit() || s[0]=='-' || s=="true" || s=="false" || s=="null")) {
+        syntaxError = QObject::tr("Unexpected character at position %1").arg(charPos);
+        return false;
+    }
+    return true;
+}
+
+void JCardFile::importCard(const QVariantList &properties, ContactList &list)
+{
+    list.push_back(ContactItem());
+    ContactItem& item = list.last();
+    item.originalFormat = "JCARD";
+    QString visName;
+    for (int i=0; i<properties.count(); i++) {
+        // [name, {parameters}, value type, value(s)]
+        QVariantList prop = properties[i].toList();
+        if (prop.count()<4) {
+            _errors << QObject::tr("Invalid property %1 in card %2").arg(i+1).arg(list.count());
+            continue;
+        }
+        const QString name = prop[0].toString().toUpper();
+        const QString valueType = prop[2].toString().toLower();
+        // Rebuild vCard property header
+        QString header = name;
+        QVariantMap params = prop[1].toMap();
+        for (QVariantMap::const_iterator it=params.constBegin(); it!=params.constEnd(); ++it) {
+            if (it.key().compare("pref", Qt::CaseInsensitive)==0)
+                header += ";TYPE=PREF";
+            else
+                header += ";" + it.key().toUpper() + "=" + valueString(it.value(), ",");
+        }
+        // Structured value is array of components
+        QStringList vValue;
+        if (prop.count()==4 && prop[3].userType()==QMetaType::QVariantList) {
+            foreach (const QVariant& component, prop[3].toList())
+                vValue << valueString(component, ",");
+        }
+        else {
+            QStringList values;
+            for (int j=3; j<prop.count(); j++)
+                values << valueString(prop[j], ",");
+            vValue << values.join(",");
+        }
+        if (name=="PHOTO") {
+            const QString uri = vValue.value(0);
+            if (uri.startsWith("data:", Qt::CaseInsensitive)) {
+                // data:image/jpeg;base64,...
+                const int commaPos = uri.indexOf(',');
+                header += ";ENCODING=B;TYPE="
+                    + uri.mid(5, commaPos-5).section(';', 0, 0).section('/', 1).toUpper();
+                vValue = QStringList(uri.mid(commaPos+1));
+            }
+            else if (valueType=="uri")
+                header += ";VALUE=uri";
+        }
+        VCardProperty vProp;
+        parseProperty(header, vProp, i, _errors);
+        importValue(vProp, vValue, item, visName, i, _errors);
+    }
+    item.calculateFields();
+}
+
+QString JCardFile::valueString(const QVariant &value, const QString &separator)
+{
+    if (value.userType()==QMetaType::QVariantList) {
+        QStringList parts;
+        foreach (const QVariant& part, value.toList())
+            parts << part.toString();
+        return parts.join(separator);
+    }
+    return value.toString();
+}
+
+bool JCardFile::exportRecords(const QString &url, ContactList &list)
+{
+    if (!openSink(url))
+        return false;
+    _errors.clear();
+    sink.setCodec("UTF-8");
+    // Array of cards; each card is converted and written as soon as built
+    sink << "[";
+    QStringList lines;
+    for (int i=0; i<list.count(); i++) {
+        lines.clear();
+        exportRecord(lines, list[i], _errors);
+        if (i>0)
+            sink << ",";
+        sink.endLine();
+        putCard(lines);
+    }
+    sink.endLine();
+    sink << "]";
+    sink.endLine();
+    return closeSink();
+}
+
+void JCardFile::putCard(const QStringList &lines)
+{
+    sink << "[\"vcard\",[";
+    bool firstProp = true;
+    for (int i=0; i<lines.count(); i++) {
+        QString line = lines[i];
+        if (line.isEmpty() || line=="BEGIN:VCARD" || line=="END:VCARD")
+            continue;
+        // Base64 photo continues on next lines
+        while (i<lines.count()-1 && lines[i+1].startsWith(' '))
+            line += lines[++i].mid(1);
+        const int colonPos = line.indexOf(':');
+        if (colonPos==-1)
+            continue;
+        const QStringList header = line.left(colonPos).split(";");
+        const QString name = header[0].toLower();
+        QString value = line.mid(colonPos+1);
+        QString valueType = "text";
+        QStringList types;
+        QStringList otherParams; // name=value
+        bool isBase64 = false;
+        for (int j=1; j<header.count(); j++) {
+            const QString& param = header[j];
+            if (param.startsWith("TYPE=", Qt::CaseInsensitive))
+                types += param.mid(5).toLower().split(",");
+            else if (param.startsWith("ENCODING=", Qt::CaseInsensitive))
+                isBase64 = true; // only B is used without QUOTED-PRINTABLE
+            else if (param.startsWith("VALUE=", Qt::CaseInsensitive))
+                valueType = param.mid(6).toLower();
+            else if (param.startsWith("CHARSET=", Qt::CaseInsensitive))
+                continue; // JSON is always Unicode
+            else if (param.contains('='))
+                otherParams << param;
+            else
+                types << param.toLower();
+        }
+        if (name=="version")
+            value = "4.0";
+        else if (name=="bday" || name=="x-anniversary")
+            valueType = "date-and-or-time";
+        else if (name=="url" || name=="impp")
+            valueType = "uri";
+        else if (name=="photo" && isBase64) {
+            valueType = "uri";
+            value = "data:image/" + types.value(0) + ";base64," + value;
+            types.clear();
+        }
+        if (!firstProp)
+            sink << ",";
+        firstProp = false;
+        sink << "[";
+        putString(name);
+        sink << ",{";
+        if (!types.isEmpty()) {
+            sink << "\"type\":";
+            if (types.count()==1)
+                putString(types.first());
+            else {
+                sink << "[";
+                for (int j=0; j<types.count(); j++) {
+                    if (j>0)
+                        sink << ",";
+                    putString(types[j]);
+                }
+                sink << "]";
+            }
+        }
+        for (int j=0; j<otherParams.count(); j++) {
+            if (j>0 || !types.isEmpty())
+                sink << ",";
+            putString(otherParams[j].section('=', 0, 0).toLower());
+            sink << ":";
+            putString(otherParams[j].section('=', 1));
+        }
+        sink << "},";
+        putString(valueType);
+        sink << ",";
+        if (name=="n" || name=="adr") {
+            const QStringList components = value.split(";");
+            sink << "[";
+            for (int j=0; j<components.count(); j++) {
+                if (j>0)
+                    sink << ",";
+                putString(components[j]);
+            }
+            sink << "]";
+        }
+        else
+            putString(value);
+        sink << "]";
+    }
+    sink << "]]";
+}
+
+void JCardFile::putString(const QString &s)
+{
+    QString res;
+    res.reserve(s.length()+2);
+    res += '"';
+    for (int i=0; i<s.length(); i++) {
+        const QChar c = s[i];
+        switch (c.unicode()) {
+        case '"':
+            res += "\\\"";
+            break;
+        case '\\':
+            res += "\\\\";
+            break;
+        case '\n':
+            res += "\\n";
+            break;
+        case '\r':
+            res += "\\r";
+            break;
+        case '\t':
+            res += "\\t";
+            break;
+        default:
+            if (c.unicode()<0x20)
+                res += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+            else
+                res += c;
+        }
+    }
+    res += '"';
+    sink << res;
+}
@@ -0,0 +1,59 @@
+/* Double Contact
+ *
+ * Module: jCard (RFC 7095, JSON vCard) file export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef JCARDFILE_H
+#define JCARDFILE_H
+
+#include <QTextDecoder>
+#include <QVariant>
+#include "fileformat.h"
+#include "filesniffer.h"
+#include "../common/vcarddata.h"
+
+// Properties are converted from/to vCard properties of VCardData.
+// Cards are parsed and written one by one, without whole JSON document in memory
+class JCardFile : public FileFormat, VCardData
+{
+public:
+    JCardFile();
+    virtual ~JCardFile();
+    // IFormat interface
+public:
+    static int detect(const FileSniffer& sniffer);
+    static QStringList supportedExtensions();
+    static QStringList supportedFilters();
+    bool importRecords(const QString &url, ContactList &list, bool append);
+    bool exportRecords(const QString &url, ContactList &list);
+private:
+    // Reader state
+    QTextDecoder* decoder;
+    QString buffer;
+    int bufferPos;
+    qint64 charPos; // for error messages
+    QString syntaxError;
+    bool fillBuffer();
+    bool nextChar(QChar& c);
+    bool peekChar(QChar& c); // skips whitespace
+    void skipChar();
+    bool expectChar(char c);
+    bool readValue(QVariant& value, int depth);
+    bool readString(QString& s);
+    bool readLiteral(QString& s); // number, true, false, null
+    void importCard(const QVariantList& properties, ContactList& list);
+    static QString valueString(const QVariant& value, const QString& separator);
+    // Writer
+    void putCard(const QStringList& lines);
+    void putString(const QString& s);
+};
+
+#endif // JCARDFILE_H
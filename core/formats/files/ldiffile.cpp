@@ -0,0 +1,450 @@
+/* Double Contact
+ *
+ * Module: LDIF (RFC 2849) file export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QObject>
+#include "globals.h"
+#include "ldiffile.h"
+
+// Max line length on write; longer lines are folded
+#define LDIF_LINE_LEN 76
+
+// On import, all names are recognized; on export, first attribute
+// of given kind, type and part is used. Attributes besides inetOrgPerson
+// schema are the same as in Mozilla Thunderbird address book LDIF
+static const LDIFFile::Attribute ldifAttributes[] = {
+    {"dn", LDIFFile::fkDN, 0, ""},
+    {"objectClass", LDIFFile::fkSkip, 0, ""},
+    {"changetype", LDIFFile::fkSkip, 0, ""},
+    {"modifytimestamp", LDIFFile::fkSkip, 0, ""},
+    {"cn", LDIFFile::fkFullName, 0, ""},
+    {"commonName", LDIFFile::fkFullName, 0, ""},
+    {"displayName", LDIFFile::fkDisplayName, 0, ""},
+    {"sn", LDIFFile::fkNames, 0, ""},
+    {"surname", LDIFFile::fkNames, 0, ""},
+    {"givenName", LDIFFile::fkNames, 1, ""},
+    {"mozillaNickname", LDIFFile::fkNickName, 0, ""},
+    {"o", LDIFFile::fkOrganization, 0, ""},
+    {"title", LDIFFile::fkTitle, 0, ""},
+    {"description", LDIFFile::fkDescription, 0, ""},
+    {"labeledURI", LDIFFile::fkUrl, 0, ""},
+    {"mozillaWorkUrl", LDIFFile::fkUrl, 0, ""},
+    {"jpegPhoto", LDIFFile::fkPhoto, 0, ""},
+    // Phones: more specific types first
+    {"mobile", LDIFFile::fkPhone, 0, "cell"},
+    {"facsimileTelephoneNumber", LDIFFile::fkPhone, 0, "fax"},
+    {"fax", LDIFFile::fkPhone, 0, "fax"},
+    {"pager", LDIFFile::fkPhone, 0, "pager"},
+    {"homePhone", LDIFFile::fkPhone, 0, "home"},
+    {"telephoneNumber", LDIFFile::fkPhone, 0, "work"},
+    {"mail", LDIFFile::fkEmail, 0, "internet"},
+    {"mozillaSecondEmail", LDIFFile::fkEmail, 0, "internet"},
+    {"postOfficeBox", LDIFFile::fkAddress, LDIFFile::apOfficeBox, "work"},
+    {"street", LDIFFile::fkAddress, LDIFFile::apStreet, "work"},
+    {"l", LDIFFile::fkAddress, LDIFFile::apCity, "work"},
+    {"st", LDIFFile::fkAddress, LDIFFile::apRegion, "work"},
+    {"postalCode", LDIFFile::fkAddress, LDIFFile::apPostalCode, "work"},
+    {"c", LDIFFile::fkAddress, LDIFFile::apCountry, "work"},
+    {"mozillaHomeStreet", LDIFFile::fkAddress, LDIFFile::apStreet, "home"},
+    {"mozillaHomeLocalityName", LDIFFile::fkAddress, LDIFFile::apCity, "home"},
+    {"mozillaHomeState", LDIFFile::fkAddress, LDIFFile::apRegion, "home"},
+    {"mozillaHomePostalCode", LDIFFile::fkAddress, LDIFFile::apPostalCode, "home"},
+    {"mozillaHomeCountryName", LDIFFile::fkAddress, LDIFFile::apCountry, "home"}
+};
+
+static const int ldifAttributeCount = sizeof(ldifAttributes)/sizeof(ldifAttributes[0]);
+
+// Unknown attribute with binary value is kept as base64 in tag "name:"
+#define LDIF_BASE64_TAG_SUFFIX ":"
+
+LDIFFile::LDIFFile()
+    :FileFormat(), hasNextLine(false), lineNum(0), nextLineNum(0)
+{
+    for (int i=0; i<ldifAttributeCount; i++)
+        attrIndexes.insert(QString(ldifAttributes[i].name).toLower(), i);
+}
+
+int LDIFFile::detect(const FileSniffer &sniffer)
+{
+    // First line besides comments
+    foreach (const QByteArray& rawLine, sniffer.head.split('\n')) {
+        QByteArray line = rawLine.trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        if (line.startsWith("version:") || line.startsWith("dn:"))
+            return FileSniffer::Sure;
+        break;
+    }
+    return FileSniffer::NotDetected;
+}
+
+QStringList LDIFFile::supportedExtensions()
+{
+    return (QStringList() << "ldif" << "LDIF" << "ldi" << "LDI" << "ldif.gz" << "LDIF.GZ");
+}
+
+QStringList LDIFFile::supportedFilters()
+{
+    return (QStringList() << "LDIF (*.ldif *.LDIF *.ldi *.LDI *.ldif.gz)");
+}
+
+bool LDIFFile::importRecords(const QString &url, ContactList &list, bool append)
+{
+    if (!openInput(url, supportedExtensions()))
+        return false;
+    _errors.clear();
+    if (!append)
+        list.clear();
+    int startCount = list.count();
+    hasNextLine = false;
+    lineNum = nextLineNum = 0;
+    ContactItem* item = 0;
+    QByteArray line;
+    while (readLine(line)) {
+        // Records are separated by empty lines
+        if (line.isEmpty()) {
+            if (item) {
+                item->dropFinalEmptyNames();
+                item->calculateFields();
+                item = 0;
+            }
+            continue;
+        }
+        if (line.startsWith('#'))
+            continue;
+        int colonPos = line.indexOf(':');
+        if (colonPos<=0) {
+            _errors << QObject::tr("Can't parse LDIF line %1").arg(lineNum);
+            continue;
+        }
+        // Attribute options (;lang-ru, ;binary, etc.) are ignored
+        QString name = QString::fromLatin1(line.constData(), colonPos).section(';', 0, 0);
+        int pos = colonPos+1;
+        bool isBase64 = (pos<line.size() && line[pos]==':');
+        bool isURL = (pos<line.size() && line[pos]=='<');
+        if (isBase64 || isURL)
+            pos++;
+        while (pos<line.size() && line[pos]==' ')
+            pos++;
+        QByteArray value = line.mid(pos);
+        if (!item) {
+            if (name.compare("version", Qt::CaseInsensitive)==0)
+                continue;
+            list.push_back(ContactItem());
+            item = &list.last();
+            item->originalFormat = "LDIF";
+        }
+        if (isURL) {
+            _errors << QObject::tr("Values by URL are not supported at line %1: %2")
+                .arg(lineNum).arg(name);
+            continue;
+        }
+        importAttribute(name, value, isBase64, *item);
+    }
+    if (item) {
+        item->dropFinalEmptyNames();
+        item->calculateFields();
+    }
+    closeInput();
+    // Unknown tags statistics
+    int totalUnknownTags = 0;
+    for (int i=startCount; i<list.count(); i++)
+        totalUnknownTags += list[i].unknownTags.count();
+    if (totalUnknownTags)
+        _errors << QObject::tr("%1 unknown tags found").arg(totalUnknownTags);
+    // Ready
+    return (!list.isEmpty());
+}
+
+bool LDIFFile::readLine(QByteArray &line)
+{
+    if (!hasNextLine && !readPhysicalLine(nextLine))
+        return false;
+    line = nextLine;
+    lineNum = nextLineNum;
+    // Folded line continues on lines, started with single space
+    while ((hasNextLine = readPhysicalLine(nextLine)) && nextLine.startsWith(' '))
+        line.append(nextLine.constData()+1, nextLine.size()-1);
+    return true;
+}
+
+bool LDIFFile::readPhysicalLine(QByteArray &line)
+{
+    line = input->readLine();
+    if (line.isEmpty()) // empty line in file is "\n"
+        return false;
+    nextLineNum++;
+    if (line.endsWith('\n'))
+        line.chop(1);
+    if (line.endsWith('\r'))
+        line.chop(1);
+    return true;
+}
+
+void LDIFFile::importAttribute(const QString &name, const QByteArray &value, bool isBase64, ContactItem &item)
+{
+    const int index = attrIndexes.value(name.toLower(), -1);
+    if (index==-1) {
+        if (isBase64)
+            item.unknownTags << TagValue(name + LDIF_BASE64_TAG_SUFFIX, QString::fromLatin1(value));
+        else
+            item.unknownTags << TagValue(name, QString::fromUtf8(value));
+        return;
+    }
+    const Attribute& attr = ldifAttributes[index];
+    const QByteArray data = isBase64 ? QByteArray::fromBase64(value) : value;
+    if (attr.kind==fkPhoto) {
+        if (item.photo.isEmpty()) {
+            item.photo.pType = "JPEG";
+            item.photo.data = data;
+        }
+        return;
+    }
+    const QString text = QString::fromUtf8(data);
+    switch (attr.kind) {
+    case fkDN:
+        item.id = text;
+        break;
+    case fkFullName:
+        item.fullName = text;
+        break;
+    case fkDisplayName: // cn has priority
+        if (item.fullName.isEmpty())
+            item.fullName = text;
+        break;
+    case fkNames:
+        while (item.names.count()<=attr.part)
+            item.names << "";
+        item.names[attr.part] = text;
+        break;
+    case fkNickName:
+        item.nickName = text;
+        break;
+    case fkOrganization:
+        item.organization = text;
+        break;
+    case fkTitle:
+        item.title = text;
+        break;
+    case fkDescription:
+        item.description = text;
+        break;
+    case fkUrl: // labeledURI is "URL label"
+        if (item.url.isEmpty())
+            item.url = text.section(' ', 0, 0);
+        break;
+    case fkPhone: {
+        Phone phone(text, attr.type);
+        phone.syncMLRef = -1;
+        item.phones << phone;
+        break;
+    }
+    case fkEmail: {
+        Email email(text, attr.type);
+        email.syncMLRef = -1;
+        item.emails << email;
+        break;
+    }
+    case fkAddress: {
+        PostalAddress& addr = addressByType(item, attr.type);
+        switch (attr.part) {
+        case apOfficeBox:
+            addr.offBox = text;
+            break;
+        case apStreet:
+            addr.street = text;
+            break;
+        case apCity:
+            addr.city = text;
+            break;
+        case apRegion:
+            addr.region = text;
+            break;
+        case apPostalCode:
+            addr.postalCode = text;
+            break;
+        case apCountry:
+            addr.country = text;
+            break;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+PostalAddress &LDIFFile::addressByType(ContactItem &item, const QString &type)
+{
+    for (int i=0; i<item.addrs.count(); i++)
+        if (item.addrs[i].types.contains(type))
+            return item.addrs[i];
+    PostalAddress addr;
+    addr.types << type;
+    addr.syncMLRef = -1;
+    item.addrs << addr;
+    return item.addrs.last();
+}
+
+bool LDIFFile::exportRecords(const QString &url, ContactList &list)
+{
+    if (!openSink(url))
+        return false;
+    _errors.clear();
+    // Values besides 7-bit are base64-encoded, so codec matters for comments only
+    sink.setCodec("UTF-8");
+    sink << "version: 1";
+    sink.endLine();
+    foreach (const ContactItem& item, list) {
+        const QString& name = item.visibleName();
+        sink.endLine();
+        putAttribute("dn", distinguishedName(item));
+        // First home address and first other address
+        const PostalAddress* homeAddr = 0;
+        const PostalAddress* workAddr = 0;
+        for (int i=0; i<item.addrs.count(); i++) {
+            const PostalAddress& addr = item.addrs[i];
+            if (!homeAddr && addr.types.contains("home", Qt::CaseInsensitive))
+                homeAddr = &addr;
+            else if (!workAddr)
+                workAddr = &addr;
+        }
+        putAttribute("objectClass", "top");
+        putAttribute("objectClass", "person");
+        putAttribute("objectClass", "organizationalPerson");
+        putAttribute("objectClass", "inetOrgPerson");
+        // Attributes, not present in inetOrgPerson
+        if (!item.nickName.isEmpty() || homeAddr)
+            putAttribute("objectClass", "mozillaAbPersonAlpha");
+        const QString cn = item.fullName.isEmpty() ? name : item.fullName;
+        putAttribute("cn", cn);
+        // sn is required by person schema
+        putAttribute("sn", item.names.value(0).isEmpty() ? cn : item.names[0]);
+        putAttribute("givenName", item.names.value(1));
+        lossData(_errors, name, S_MIDDLE_NAME, item.names.mid(2).join("").trimmed());
+        putAttribute("mozillaNickname", item.nickName);
+        putAttribute("o", item.organization);
+        putAttribute("title", item.title);
+        putAttribute("description", item.description);
+        putAttribute("labeledURI", item.url);
+        foreach (const Phone& phone, item.phones) {
+            QString attrName = "telephoneNumber";
+            for (int i=0; i<ldifAttributeCount; i++)
+                if (ldifAttributes[i].kind==fkPhone
+                        && phone.types.contains(ldifAttributes[i].type, Qt::CaseInsensitive)) {
+                    attrName = ldifAttributes[i].name;
+                    break;
+                }
+            putAttribute(attrName, phone.value);
+        }
+        foreach (const Email& email, item.emails)
+            putAttribute("mail", email.value);
+        for (int i=0; i<ldifAttributeCount; i++) {
+            const Attribute& attr = ldifAttributes[i];
+            if (attr.kind!=fkAddress)
+                continue;
+            const PostalAddress* addr = (QString(attr.type)=="home") ? homeAddr : workAddr;
+            if (!addr)
+                continue;
+            switch (attr.part) {
+            case apOfficeBox:
+                putAttribute(attr.name, addr->offBox);
+                break;
+            case apStreet:
+                putAttribute(attr.name, addr->street);
+                break;
+            case apCity:
+                putAttribute(attr.name, addr->city);
+                break;
+            case apRegion:
+                putAttribute(attr.name, addr->region);
+                break;
+            case apPostalCode:
+                putAttribute(attr.name, addr->postalCode);
+                break;
+            case apCountry:
+                putAttribute(attr.name, addr->country);
+                break;
+            }
+        }
+        lossData(_errors, name, S_ADR_OFFICE_BOX, homeAddr ? homeAddr->offBox : "");
+        lossData(_errors, name, S_ADR_EXTENDED,
+            (homeAddr && !homeAddr->extended.isEmpty()) || (workAddr && !workAddr->extended.isEmpty()));
+        lossData(_errors, name, S_ADDR, item.addrs.count()>(homeAddr ? 1 : 0)+(workAddr ? 1 : 0));
+        if (item.photo.pType.toUpper()=="JPEG")
+            putBinaryAttribute("jpegPhoto", item.photo.data);
+        else
+            lossData(_errors, name, S_PHOTO, !item.photo.isEmpty());
+        lossData(_errors, name, S_BDAY, !item.birthday.isEmpty());
+        lossData(_errors, name, S_ANN, !item.anniversaries.isEmpty());
+        lossData(_errors, name, S_IM, !item.ims.isEmpty());
+        // Unknown attributes are written back only to LDIF
+        if (item.originalFormat=="LDIF")
+            foreach (const TagValue& tag, item.unknownTags) {
+                if (tag.tag.endsWith(LDIF_BASE64_TAG_SUFFIX))
+                    putFolded(tag.tag + ": " + tag.value);
+                else
+                    putAttribute(tag.tag, tag.value);
+            }
+    }
+    return closeSink();
+}
+
+void LDIFFile::putAttribute(const QString &name, const QString &value)
+{
+    if (value.isEmpty())
+        return;
+    // SAFE-STRING of RFC 2849: 7-bit, without NUL, CR, LF;
+    // can't start with space, colon or less-than and end with space
+    bool safe = (value[0]!=' ' && value[0]!=':' && value[0]!='<' && !value.endsWith(' '));
+    for (int i=0; safe && i<value.length(); i++) {
+        const ushort c = value[i].unicode();
+        safe = (c!=0 && c!='\n' && c!='\r' && c<128);
+    }
+    if (safe)
+        putFolded(name + ": " + value);
+    else
+        putBinaryAttribute(name, value.toUtf8());
+}
+
+void LDIFFile::putBinaryAttribute(const QString &name, const QByteArray &value)
+{
+    if (!value.isEmpty())
+        putFolded(name + ":: " + QString::fromLatin1(value.toBase64()));
+}
+
+void LDIFFile::putFolded(const QString &line)
+{
+    sink << line.left(LDIF_LINE_LEN);
+    for (int pos=LDIF_LINE_LEN; pos<line.length(); pos+=LDIF_LINE_LEN-1) {
+        sink.endLine();
+        sink << " " << line.mid(pos, LDIF_LINE_LEN-1);
+    }
+    sink.endLine();
+}
+
+QString LDIFFile::distinguishedName(const ContactItem &item)
+{
+    if (item.originalFormat=="LDIF" && !item.id.isEmpty())
+        return item.id;
+    // RFC 4514 escaping of attribute value
+    QString cn = item.fullName.isEmpty() ? item.visibleName() : item.fullName;
+    QString res = "cn=";
+    for (int i=0; i<cn.length(); i++) {
+        const QChar c = cn[i];
+        if (QString(",+\"\\<>;=").contains(c)
+                || (i==0 && (c=='#' || c==' ')) || (i==cn.length()-1 && c==' '))
+            res += '\\';
+        res += c;
+    }
+    return res;
+}
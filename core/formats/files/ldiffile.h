@@ -0,0 +1,67 @@
+/* Double Contact
+ *
+ * Module: LDIF (RFC 2849) file export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef LDIFFILE_H
+#define LDIFFILE_H
+
+#include <QHash>
+#include "fileformat.h"
+#include "filesniffer.h"
+
+// Records are parsed while reading, line by line,
+// so huge LDAP directory dumps are read in constant memory
+class LDIFFile : public FileFormat
+{
+public:
+    LDIFFile();
+    // IFormat interface
+public:
+    static int detect(const FileSniffer& sniffer);
+    static QStringList supportedExtensions();
+    static QStringList supportedFilters();
+    bool importRecords(const QString &url, ContactList &list, bool append);
+    bool exportRecords(const QString &url, ContactList &list);
+    // Mapping of LDAP attributes to contact fields
+    enum FieldKind {
+        fkSkip,
+        fkDN, fkFullName, fkDisplayName, fkNames, fkNickName,
+        fkOrganization, fkTitle, fkDescription, fkUrl, fkPhoto,
+        fkPhone, fkEmail, fkAddress
+    };
+    enum AddressPart {
+        apOfficeBox, apStreet, apCity, apRegion, apPostalCode, apCountry
+    };
+    struct Attribute {
+        const char* name;
+        FieldKind kind;
+        int part;         // name index or AddressPart
+        const char* type; // phone/email/address type
+    };
+private:
+    QHash<QString, int> attrIndexes; // lower case attribute name -> table index
+    // Reader state
+    QByteArray nextLine; // read ahead to find folded line end
+    bool hasNextLine;
+    int lineNum, nextLineNum;
+    bool readLine(QByteArray& line);
+    bool readPhysicalLine(QByteArray& line);
+    void importAttribute(const QString& name, const QByteArray& value, bool isBase64, ContactItem& item);
+    static PostalAddress& addressByType(ContactItem& item, const QString& type);
+    // Writer
+    void putAttribute(const QString& name, const QString& value);
+    void putBinaryAttribute(const QString& name, const QByteArray& value);
+    void putFolded(const QString& line);
+    static QString distinguishedName(const ContactItem& item);
+};
+
+#endif // LDIFFILE_H
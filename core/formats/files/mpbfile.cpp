@@ -10,6 +10,9 @@
  * (at your option) any later version. See COPYING file for more details.
  *
  */
+#include <QHash>
+#include <climits>
+#include <QSet>
 #include "mpbfile.h"
 #include <QStringList>
 
@@ -20,14 +23,11 @@ MPBFile::MPBFile()
 {
 }
 
-bool MPBFile::detect(const QString &url)
+int MPBFile::detect(const FileSniffer &sniffer)
 {
-    QFile f(url);
-    if (!f.open(QIODevice::ReadOnly)) return false;
-    QTextStream stream(&f);
-    QString line = stream.readLine();
-    f.close();
-    return line.contains(SECTION_BEGIN);
+    if (sniffer.firstLine().contains(SECTION_BEGIN))
+        return FileSniffer::Sure;
+    return FileSniffer::NotDetected;
 }
 
 QStringList MPBFile::supportedExtensions()
@@ -47,103 +47,59 @@ bool MPBFile::importRecords(const QString &url, ContactList &list, bool append)
     _errors.clear();
     if (!append) // not in VCardData::importRecords; else extra data will be lost
         list.clear();
-    // Read file
-    QStringList content;
-    QTextStream stream(&file);
-    enum Section {
-        secNotFound,
-        secUnknown,
-        secPhonebook,
-        secCalls,
-        secOrganizer,
-        secNotes,
-        secSMS,
-        secSMSArchive
-    };
-    Section section = secNotFound;
-    do {
-        QString line = stream.readLine();
-        // MPB section changes
-        int secPos = line.indexOf(SECTION_BEGIN);
-        if (secPos!=-1) {
-            // qDebug() << "sP " << secPos;
-            QString secName = line.mid(secPos+SECTION_BEGIN.length());
-            if (secName=="Model")
-                list.extra.model = stream.readLine();
-            else if (secName=="TimeStamp")
-                list.extra.timeStamp = stream.readLine();
-            else if (secName=="Phonebook")
-                section = secPhonebook;
-            else if (secName=="Calls")
-                section = secCalls;
-            else if (secName=="Organizer")
-                section = secOrganizer;
-            else if (secName=="Notes")
-                section = secNotes;
-            else if (secName=="SMS")
-                section = secSMS;
-            else if (secName=="SMSArchive")
-                section = secSMSArchive;
-            else if (secName=="EndofData")
-                break;
-            else
-                _errors << QObject::tr("Unsupported MPB section: ") + secName;
-            if (section==secSMSArchive)
-                stream.setCodec("CP1251");
-            else if (section==secCalls)
-                stream.setCodec("UTF-8");
-        }
-        // MPB section content
-        else
-        switch (section) {
-        case secNotFound:
-            _fatalError = QObject::tr("File isn't MPB file or corrupted");
-            return false;
-        case secUnknown:
-            break;
-        case secPhonebook:
-            content << line;
-            break;
-        case secCalls: {
-            QStringList cells = line.split('\t');
-            if (cells.count()!=6)
-                _errors << QObject::tr("Strange call item: %1, size %2")
-                           .arg(line).arg(cells.count());
-            if (cells.count()>=6) {
-                CallInfo call;
-                call.cType = cells[0];
-                call.timeStamp = cells[1];
-                call.duration = cells[2];
-                call.number = cells[3];
-                call.name = cells[4];
-                list.extra.calls << call;
-            }
-            break;
-        }
-        case secOrganizer:
-            list.extra.organizer << line;
-            break;
-        case secNotes:
-            list.extra.notes << line;
-            break;
-        case secSMS:
-            list.extra.SMS << line;
+    // Find sections in one byte-level scan over mapped file;
+    // only stored sections are copied, not whole file
+    const qint64 fileSize = file.size();
+    uchar* mapped = (fileSize>0 && fileSize<INT_MAX) ? file.map(0, fileSize) : 0;
+    QByteArray buffer; // for files which can't be mapped
+    if (!mapped)
+        buffer = file.readAll();
+    const QByteArray data = mapped
+        ? QByteArray::fromRawData((const char*)mapped, (int)fileSize) : buffer;
+    const QByteArray marker = SECTION_BEGIN.toLatin1();
+    QByteArray phonebook;
+    int pos = data.indexOf(marker);
+    // Anything before first section header line means not MPB file
+    if (pos==-1 || data.lastIndexOf('\n', pos)!=-1) {
+        closeFile();
+        _fatalError = QObject::tr("File isn't MPB file or corrupted");
+        return false;
+    }
+    while (pos!=-1) {
+        // Section header is whole line with marker; content starts from next line
+        int nameStart = pos+marker.length();
+        int nameEnd = data.indexOf('\n', nameStart);
+        int contentStart = (nameEnd==-1) ? data.length() : nameEnd+1;
+        if (nameEnd==-1)
+            nameEnd = data.length();
+        QString secName = QString::fromLatin1(data.mid(nameStart, nameEnd-nameStart)).trimmed();
+        if (secName=="EndofData")
             break;
-        case secSMSArchive:
-            list.extra.SMSArchive << line;
-        }
-    } while (!stream.atEnd());
-    closeFile();
+        // Content ends before line with next marker
+        int nextPos = data.indexOf(marker, contentStart);
+        int contentEnd = data.length();
+        if (nextPos!=-1)
+            contentEnd = data.lastIndexOf('\n', nextPos)+1;
+        if (contentEnd<contentStart)
+            contentEnd = contentStart;
+        // Deep copy, because mapping ends with file closing
+        storeSection(list.extra, secName,
+            QByteArray(data.constData()+contentStart, contentEnd-contentStart), phonebook);
+        pos = nextPos;
+    }
+    closeFile(); // also unmaps file
     // Warning on Sony Ericsson
     if (list.extra.model.contains("Sony")||list.extra.model.contains("Eric")) // TODO remove, when test
         _errors << "Program was tested only on Android MPB files, not SonyEricsson. Please, contact author";
     // Parse contact list
-    if (content.isEmpty()) {
+    QStringList phonebookLines = MPBExtra::decodeLines(phonebook, "UTF-8");
+    phonebook.clear();
+    if (phonebookLines.isEmpty()) {
         // TODO maybe move this string to global for other formats
         _fatalError = QObject::tr("No contact records in this file");
         return false;
     }
-    return VCardData::importRecords(content, list, true, _errors);
+    return VCardData::importRecords(phonebookLines, list, true, _errors);
 }
 
 bool MPBFile::exportRecords(const QString &url, ContactList &list)
@@ -168,39 +124,45 @@ bool MPBFile::exportRecords(const QString &url, ContactList &list)
     forceShortDate = true; // force ISO basic date format
     if (!VCardData::exportRecords(content, list, _errors))
         return false;
-    if (!openFile(url, QIODevice::WriteOnly))
+    if (!openSink(url))
         return false;
     _errors.clear();
-    QTextStream stream(&file);
+    sink.setLineEnding(OutputSink::CRLF);
     // Prelude sections
-    writeSectionHeader(stream, "Model");
-    stream << list.extra.model;
-    winEndl(stream);
-    writeSectionHeader(stream, "TimeStamp");
-    stream << list.extra.timeStamp;
-    winEndl(stream);
+    writeSectionHeader("Model");
+    sink << list.extra.model;
+    sink.endLine();
+    writeSectionHeader("TimeStamp");
+    sink << list.extra.timeStamp;
+    sink.endLine();
     // Phone book
-    writeSectionHeader(stream, "Phonebook");
+    writeSectionHeader("Phonebook");
     foreach (const QString& line, content) {
-        stream << line;
-        winEndl(stream);
+        sink << line;
+        sink.endLine();
     }
-    winEndl(stream);
+    sink.endLine();
     // Call history
-    writeSectionHeader(stream, "Calls");
-    foreach (const CallInfo& call, list.extra.calls) {
+    writeSectionHeader("Calls");
+    // Indexes for call name lookup, built once; first contact with given number wins
+    QHash<QString, int> numberIndex;
+    QSet<QString> fullNames;
+    for (int i=0; i<list.count(); i++) {
+        const ContactItem& item = list[i];
+        foreach(const Phone& phone, item.phones) {
+            const QString number = phone.expandNumber(gd.defaultCountryRule);
+            if (!numberIndex.contains(number))
+                numberIndex.insert(number, i);
+        }
+        fullNames.insert(item.fullName);
+    }
+    _errors << list.extra.takeDecodeErrors();
+    foreach (const CallInfo& call, list.extra.calls()) {
         // Change name if was edited
         QString aboName = call.name;
-        QString foundName = "";
-        foreach(const ContactItem& candItem, list) {
-            foreach(const Phone& candPhone, candItem.phones) {
-                if (candPhone.expandNumber(gd.defaultCountryRule)==Phone::expandNumber(call.number, gd.defaultCountryRule)) {
-                    foundName = candItem.makeGenericName();
-                    break;
-                }
-            }
-            if (!foundName.isEmpty()) break;
-        }
+        QHash<QString, int>::const_iterator found
+            = numberIndex.constFind(Phone::expandNumber(call.number, gd.defaultCountryRule));
+        QString foundName = (found==numberIndex.constEnd()) ? "" : list[found.value()].makeGenericName();
         if (!foundName.isEmpty()) {
             if (aboName != foundName && !foundName.isEmpty())
                 _errors << QObject::tr("Name for number %1 changed from %2 to %3")
@@ -208,65 +170,85 @@ bool MPBFile::exportRecords(const QString &url, ContactList &list)
             aboName = foundName;
         }
         else if (!aboName.isEmpty()) {
-            foreach(const ContactItem& candItem, list) {
-                if (candItem.fullName==aboName) {
-                    foundName = candItem.fullName;
-                    break;
-                }
-            }
-            if (foundName.isEmpty())
+            if (!fullNames.contains(aboName))
                 _errors << QObject::tr("Number %1 without original name not found in addressbook").arg(call.number);
             else
                 _errors << QObject::tr("Number %1 not found in addressbook. Original name (%2) saved").arg(call.number).arg(aboName);
         }
         // Write call item
-        stream
+        sink
             << call.cType << '\t'
             << call.timeStamp << '\t'
             << call.duration << '\t'
             << call.number << '\t'
             << aboName << '\t';
-        winEndl(stream);
+        sink.endLine();
     }
     // Interlude sections
-    writeSectionHeader(stream, "Organizer");
-    foreach (const QString& line, list.extra.organizer) {
-        stream << line;
-        winEndl(stream);
-    }
-    writeSectionHeader(stream, "Notes");
-    foreach (const QString& line, list.extra.notes) {
-        stream << line;
-        winEndl(stream);
-    }
+    writeExtraSection(list.extra, MPBExtra::secOrganizer, "Organizer");
+    writeExtraSection(list.extra, MPBExtra::secNotes, "Notes");
     // SMS
-    writeSectionHeader(stream, "SMS");
-    foreach (const QString& line, list.extra.SMS) {
-        stream << line;
-        winEndl(stream);
-    }
+    writeExtraSection(list.extra, MPBExtra::secSMS, "SMS");
     // SMS archive
-    writeSectionHeader(stream, "SMSArchive","CP1251"); // TODO check with various countries/locales.
-    foreach (const QString& line, list.extra.SMSArchive) {
-        stream << line;
-        winEndl(stream);
-    }
+    writeExtraSection(list.extra, MPBExtra::secSMSArchive, "SMSArchive");
     // Coda
-    writeSectionHeader(stream, "EndofData", "ISO 8859-1", false); // without endl!
-    closeFile();
-    return true;
+    writeSectionHeader("EndofData", "ISO 8859-1", false); // without endl!
+    return closeSink();
 }
 
-void MPBFile::writeSectionHeader(QTextStream &stream, const QString &sectionName, const char* codecAfter, bool writeEOL)
+void MPBFile::writeSectionHeader(const QString &sectionName, const char* codecAfter, bool writeEOL)
 {
-    stream.setCodec("ISO 8859-1"); // to provide correct 0xff write
-    stream << '\xff' << SECTION_BEGIN << sectionName;
+    // Raw, to provide correct 0xff write
+    sink.writeRaw('\xff' + (SECTION_BEGIN + sectionName).toLatin1());
     if (writeEOL)
-        winEndl(stream);
-    stream.setCodec(codecAfter);
+        sink.writeRaw("\r\n");
+    sink.setCodec(codecAfter);
+}
+
+void MPBFile::writeExtraSection(const MPBExtra &extra, MPBExtra::Section section, const QString &sectionName)
+{
+    writeSectionHeader(sectionName, MPBExtra::codecName(section));
+    if (extra.hasRaw(section)) // unchanged since import
+        sink.writeRaw(extra.raw(section));
+    else
+    foreach (const QString& line, extra.lines(section)) {
+        sink << line;
+        sink.endLine();
+    }
+}
+
+void MPBFile::storeSection(MPBExtra &extra, const QString &secName, const QByteArray &content, QByteArray &phonebook)
+{
+    if (secName=="Model")
+        extra.model = firstLine(content);
+    else if (secName=="TimeStamp")
+        extra.timeStamp = firstLine(content);
+    else if (secName=="Phonebook")
+        phonebook += content;
+    else if (secName=="Calls")
+        appendRawSection(extra, MPBExtra::secCalls, content);
+    else if (secName=="Organizer")
+        appendRawSection(extra, MPBExtra::secOrganizer, content);
+    else if (secName=="Notes")
+        appendRawSection(extra, MPBExtra::secNotes, content);
+    else if (secName=="SMS")
+        appendRawSection(extra, MPBExtra::secSMS, content);
+    else if (secName=="SMSArchive")
+        appendRawSection(extra, MPBExtra::secSMSArchive, content);
+    else
+        _errors << QObject::tr("Unsupported MPB section: ") + secName;
+}
+
+void MPBFile::appendRawSection(MPBExtra &extra, MPBExtra::Section section, const QByteArray &content)
+{
+    if (extra.hasRaw(section)) // repeated section
+        extra.setRaw(section, extra.raw(section)+content);
+    else
+        extra.setRaw(section, content);
 }
 
-void MPBFile::winEndl(QTextStream &stream)
+QString MPBFile::firstLine(const QByteArray &content)
 {
-    stream << (char)13 << endl;
+    QStringList lines = MPBExtra::decodeLines(content.left(content.indexOf('\n')+1), "UTF-8");
+    return lines.isEmpty() ? "" : lines.first();
 }
@@ -14,9 +14,8 @@
 #ifndef MPBFILE_H
 #define MPBFILE_H
 
-#include <QTextStream>
-
 #include "fileformat.h"
+#include "filesniffer.h"
 #include "../common/vcarddata.h"
 
 class MPBFile : public FileFormat, VCardData
@@ -26,15 +25,18 @@ public:
 
     // IFormat interface
 public:
-    static bool detect(const QString &url);
+    static int detect(const FileSniffer& sniffer);
     static QStringList supportedExtensions();
     static QStringList supportedFilters();
     bool importRecords(const QString &url, ContactList &list, bool append);
     bool exportRecords(const QString &url, ContactList &list);
 private:
-    void writeSectionHeader(QTextStream& stream, const QString& sectionName,
+    void writeSectionHeader(const QString& sectionName,
         const char* codecAfter="UTF-8", bool writeEOL=true);
-    void winEndl(QTextStream & stream);
+    void storeSection(MPBExtra& extra, const QString& secName, const QByteArray& content, QByteArray& phonebook);
+    void writeExtraSection(const MPBExtra& extra, MPBExtra::Section section, const QString& sectionName);
+    static void appendRawSection(MPBExtra& extra, MPBExtra::Section section, const QByteArray& content);
+    static QString firstLine(const QByteArray& content);
 };
 
 #endif // MPBFILE_H
@@ -12,27 +12,33 @@
  */
 #include <QObject>
 #include <QStringList>
-#include <QTextStream>
 #include "nbffile.h"
 #include "quazip.h"
 #include "quazipdir.h"
-#include "quazipfile.h"
+#include "zipvcardreader.h"
 
 #define NBF_VCARD_PATH QString("predefhiddenfolder/backup/WIP/32/contacts")
-
 NBFFile::NBFFile()
     :FileFormat()
 {
 }
 
-bool NBFFile::detect(const QString &url)
+int NBFFile::detect(const FileSniffer &sniffer)
 {
     // Check if file is zip archive and NBF_VCARD_PATH exists in archive
-    QuaZip nbf(url);
-    if (!nbf.open(QuaZip::mdUnzip))
-        return false;
-    QuaZipDir nbd(&nbf);
-    return nbd.cd(NBF_VCARD_PATH);
+    if (!sniffer.isZip)
+        return FileSniffer::NotDetected;
+    bool found;
+    if (sniffer.zipDirRead)
+        found = sniffer.zipHasDir(NBF_VCARD_PATH);
+    else { // i.e. zip64; let QuaZip read it
+        QuaZip nbf(sniffer.url);
+        if (!nbf.open(QuaZip::mdUnzip))
+            return FileSniffer::NotDetected;
+        QuaZipDir nbd(&nbf);
+        found = nbd.cd(NBF_VCARD_PATH);
+    }
+    return found ? FileSniffer::Exact : FileSniffer::NotDetected;
 }
 
 QStringList NBFFile::supportedExtensions()
@@ -47,40 +53,22 @@ QStringList NBFFile::supportedFilters()
 
 bool NBFFile::importRecords(const QString &url, ContactList &list, bool append)
 {
-    QuaZip nbf(url);
-    if (!nbf.open(QuaZip::mdUnzip)) {
-        _fatalError = QObject::tr("Can't open file");
+    // Each contact is a single vcf in NBF_VCARD_PATH inside archive
+    ContactList items;
+    ZipVCardReader reader;
+    bool res = reader.read(url, NBF_VCARD_PATH, "", items);
+    _errors << reader.errors;
+    if (!res) {
+        _fatalError = reader.fatalError;
         return false;
     }
-    QuaZipDir nbd(&nbf);
-    if (!nbd.cd(NBF_VCARD_PATH)) {
+    if (!reader.dirFound) {
         _fatalError = QObject::tr("Can't open %1 directory in archive").arg(NBF_VCARD_PATH);
         return false;
     }
-    // Each contact is a single vcf in NBF_VCARD_PATH inside archive
-    if (!append) list.clear(); // VCardData::importRecords must be called with append=true
-    foreach (const QString& itemID, nbd.entryList()) {
-        // DON'T replace / to QDir::separator(), it may not work on Windows!
-        if (!nbf.setCurrentFile(NBF_VCARD_PATH + "/" + itemID)) {
-            _errors << QObject::tr("Can't set %1 item as current in archive").arg(itemID);
-            continue;
-        }
-        // Open contact pseudo-file
-        QuaZipFile vcf(&nbf);
-        if (!vcf.open(QIODevice::ReadOnly)) {
-            _errors << QObject::tr("Can't open %1 item in archive").arg(itemID);
-            continue;
-        }
-        QTextStream stream(&vcf);
-        QStringList content;
-        while (!stream.atEnd())
-            content << stream.readLine();
-        vcf.close();
-        // Append one contact to list!
-        VCardData::importRecords(content, list, true, _errors);
-    }
+    if (!append) list.clear();
+    list.appendRecords(items);
     // TODO SMS, calls
-    nbf.close();
     return true;
 }
 
@@ -15,6 +15,7 @@
 #define NBFFILE_H
 
 #include "fileformat.h"
+#include "filesniffer.h"
 #include "../common/vcarddata.h"
 
 class NBFFile : public FileFormat, VCardData
@@ -24,7 +25,7 @@ public:
 
     // IFormat interface
 public:
-    static bool detect(const QString &url);
+    static int detect(const FileSniffer& sniffer);
     static QStringList supportedExtensions();
     static QStringList supportedFilters();
     bool importRecords(const QString &url, ContactList &list, bool append);
@@ -0,0 +1,280 @@
+/* Double Contact
+ *
+ * Module: Buffered output with atomic replace of target file
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QFile>
+#include "globals.h"
+#include "outputsink.h"
+#include "zlib.h"
+
+#define OUTPUT_SINK_ZBUF_SIZE 65536
+
+#if QT_VERSION >= 0x050100
+#include <QSaveFile>
+#else
+#include <QTemporaryFile>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#endif
+
+OutputSink::OutputSink()
+    :dev(0), codec(0), encoder(0), eol("\n"), error(false), isStdOut(false), zstream(0)
+{
+}
+
+OutputSink::~OutputSink()
+{
+    cancel();
+    delete encoder;
+}
+
+bool OutputSink::open(const QString &path)
+{
+    cancel();
+    this->path = path;
+    error = false;
+    eol = "\n";
+    setCodec(QTextCodec::codecForLocale()->name().constData());
+    isStdOut = (path==STD_STREAM_PATH);
+    if (isStdOut) {
+        QFile* f = new QFile();
+        dev = f;
+        if (!f->open(stdout, QIODevice::WriteOnly)) {
+            delete dev;
+            dev = 0;
+            return false;
+        }
+        text.reserve(OUTPUT_SINK_BUFFER_SIZE);
+        return true;
+    }
+#if QT_VERSION >= 0x050100
+    // QSaveFile syncs data to disk and renames temporary file in commit().
+    // Without direct write fallback: if temporary file can't be created in target
+    // directory, open() fails instead of truncating target file
+    QSaveFile* f = new QSaveFile(path);
+#else
+    QTemporaryFile* f = new QTemporaryFile(path + ".XXXXXX");
+    f->setAutoRemove(false);
+#endif
+    dev = f;
+    if (!f->open(QIODevice::WriteOnly)) {
+        delete dev;
+        dev = 0;
+        return false;
+    }
+#if QT_VERSION < 0x050100
+    tempPath = f->fileName();
+    if (QFile::exists(path))
+        f->setPermissions(QFile::permissions(path));
+    else
+        f->setPermissions(QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup | QFile::ReadOther);
+#endif
+    if (path.endsWith(".gz", Qt::CaseInsensitive)) {
+        zstream = new z_stream;
+        zstream->zalloc = Z_NULL;
+        zstream->zfree = Z_NULL;
+        zstream->opaque = Z_NULL;
+        // 16 added to window bits means gzip header and trailer
+        if (deflateInit2(zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                MAX_WBITS+16, 8, Z_DEFAULT_STRATEGY)!=Z_OK) {
+            delete zstream;
+            zstream = 0;
+            cancel();
+            return false;
+        }
+    }
+    text.reserve(OUTPUT_SINK_BUFFER_SIZE);
+    return true;
+}
+
+bool OutputSink::commit()
+{
+    if (!dev)
+        return false;
+    flushText();
+    if (zstream && !error)
+        error = !deflateData(QByteArray(), true);
+    bool res = !error;
+    if (isStdOut) {
+        // Already written data can't be withdrawn
+        if (res)
+            res = static_cast<QFile*>(dev)->flush();
+        dev->close(); // stdout itself remains open
+    }
+    else {
+#if QT_VERSION >= 0x050100
+        QSaveFile* f = static_cast<QSaveFile*>(dev);
+        if (res)
+            res = f->commit();
+        else
+            f->cancelWriting();
+#else
+        QTemporaryFile* f = static_cast<QTemporaryFile*>(dev);
+        if (res)
+            res = f->flush();
+#ifdef Q_OS_UNIX
+        if (res)
+            res = (fsync(f->handle())==0);
+#endif
+        f->close();
+        if (res) {
+            // QFile::rename doesn't overwrite existing file
+            if (QFile::exists(path))
+                QFile::remove(path);
+            res = QFile::rename(tempPath, path);
+        }
+        if (!res)
+            QFile::remove(tempPath);
+#endif
+    }
+    delete dev;
+    dev = 0;
+    text.clear();
+    if (zstream) {
+        deflateEnd(zstream);
+        delete zstream;
+        zstream = 0;
+    }
+    return res;
+}
+
+void OutputSink::cancel()
+{
+    if (!dev)
+        return;
+    if (isStdOut)
+        dev->close();
+    else {
+#if QT_VERSION >= 0x050100
+        static_cast<QSaveFile*>(dev)->cancelWriting();
+#else
+        dev->close();
+        QFile::remove(tempPath);
+#endif
+    }
+    delete dev;
+    dev = 0;
+    text.clear();
+    if (zstream) {
+        deflateEnd(zstream);
+        delete zstream;
+        zstream = 0;
+    }
+}
+
+bool OutputSink::isOpen() const
+{
+    return dev!=0;
+}
+
+bool OutputSink::hasError() const
+{
+    return error;
+}
+
+QString OutputSink::fileName() const
+{
+    return path;
+}
+
+void OutputSink::setCodec(const char *codecName, bool generateBOM)
+{
+    flushText(); // pending text belongs to previous codec
+    QTextCodec* newCodec = QTextCodec::codecForName(codecName);
+    if (!newCodec)
+        newCodec = QTextCodec::codecForLocale();
+    codec = newCodec;
+    delete encoder;
+    // Without BOM, as QTextStream::setGenerateByteOrderMark(false)
+    encoder = codec->makeEncoder(generateBOM ? QTextCodec::DefaultConversion : QTextCodec::IgnoreHeader);
+}
+
+void OutputSink::setLineEnding(OutputSink::LineEnding ending)
+{
+    eol = (ending==CRLF) ? "\r\n" : "\n";
+}
+
+OutputSink &OutputSink::operator<<(const QString &s)
+{
+    text += s;
+    if (text.length()>=OUTPUT_SINK_BUFFER_SIZE)
+        flushText();
+    return *this;
+}
+
+OutputSink &OutputSink::operator<<(const char *s)
+{
+    return *this << QString::fromLatin1(s);
+}
+
+OutputSink &OutputSink::operator<<(QChar c)
+{
+    text += c;
+    if (text.length()>=OUTPUT_SINK_BUFFER_SIZE)
+        flushText();
+    return *this;
+}
+
+void OutputSink::endLine()
+{
+    *this << eol;
+}
+
+void OutputSink::writeRaw(const QByteArray &data)
+{
+    flushText();
+    writeDevice(data);
+}
+
+QIODevice *OutputSink::device()
+{
+    flushText();
+    return dev;
+}
+
+void OutputSink::flushText()
+{
+    if (text.isEmpty() || !encoder)
+        return;
+    writeDevice(encoder->fromUnicode(text));
+    text.resize(0); // keeps reserved capacity
+}
+
+void OutputSink::writeDevice(const QByteArray &data)
+{
+    if (!dev || error)
+        return;
+    if (zstream)
+        error = !deflateData(data, false);
+    else if (dev->write(data)!=data.size())
+        error = true;
+}
+
+bool OutputSink::deflateData(const QByteArray &data, bool finish)
+{
+    char out[OUTPUT_SINK_ZBUF_SIZE];
+    zstream->next_in = (Bytef*)data.constData();
+    zstream->avail_in = data.size();
+    int res;
+    do {
+        zstream->next_out = (Bytef*)out;
+        zstream->avail_out = OUTPUT_SINK_ZBUF_SIZE;
+        res = deflate(zstream, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (res==Z_STREAM_ERROR)
+            return false;
+        qint64 size = OUTPUT_SINK_ZBUF_SIZE-zstream->avail_out;
+        if (size>0 && dev->write(out, size)!=size)
+            return false;
+    } while (zstream->avail_out==0 || (finish && res!=Z_STREAM_END));
+    return true;
+}
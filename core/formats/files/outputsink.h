@@ -0,0 +1,75 @@
+/* Double Contact
+ *
+ * Module: Buffered output with atomic replace of target file
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QTextCodec>
+
+// Max count of pending characters before encoding and writing
+#define OUTPUT_SINK_BUFFER_SIZE 262144
+
+struct z_stream_s;
+
+// Output of exporters. Text is collected in large buffer and encoded
+// by chunks; data is written to temporary file, which replaces
+// target file only in commit(), so failed export doesn't damage it.
+// If target name ends with .gz, output is gzip-compressed.
+// Target "-" means standard output, written as is (without replacing)
+class OutputSink
+{
+public:
+    enum LineEnding {
+        LF,
+        CRLF
+    };
+    OutputSink();
+    ~OutputSink(); // uncommitted output is discarded
+    bool open(const QString& path);
+    bool commit(); // flush, sync to disk and replace target
+    void cancel();
+    bool isOpen() const;
+    bool hasError() const;
+    QString fileName() const;
+    // Text output; codec is locale codec by default
+    void setCodec(const char* codecName, bool generateBOM = false);
+    void setLineEnding(LineEnding ending);
+    OutputSink& operator<<(const QString& s);
+    OutputSink& operator<<(const char* s); // Latin-1
+    OutputSink& operator<<(QChar c);
+    void endLine();
+    // Binary output, not affected by codec
+    void writeRaw(const QByteArray& data);
+    // For writers with own streams (QDataStream, QXmlStreamWriter);
+    // pending text is flushed before. Not compressed!
+    QIODevice* device();
+private:
+    Q_DISABLE_COPY(OutputSink)
+    QIODevice* dev;
+    QString path, tempPath;
+    QTextCodec* codec;
+    QTextEncoder* encoder;
+    QString text;
+    const char* eol;
+    bool error;
+    bool isStdOut;
+    z_stream_s* zstream; // if compressed
+    bool deflateData(const QByteArray& data, bool finish);
+    void flushText();
+    void writeDevice(const QByteArray& data);
+};
+
+#endif // OUTPUTSINK_H
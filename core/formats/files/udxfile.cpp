@@ -12,30 +12,28 @@
  */
 
 #include <QTextCodec>
-#include <QTextStream>
-#include <QSet>
+#include <QPair>
+#include <QtAlgorithms>
 #include "udxfile.h"
 
+// Fixed width of FileSize and vCardLength header fields
+#define UDX_NUM_FIELD_LEN 10
+
 UDXFile::UDXFile()
-    :FileFormat(), QDomDocument("DataExchangeInfo")
+    :FileFormat()
 {
 }
 
-bool UDXFile::detect(const QString &url)
+int UDXFile::detect(const FileSniffer &sniffer)
 {
-    QFile file(url);
-    // - file is readable
-    if (!file.open( QIODevice::ReadOnly))
-        return false;
-    // - file is XML
-    QDomDocument udx;
-    if (!udx.setContent(&file)) {
-        file.close();
-        return false;
-    }
-    file.close();
-    // - root file tag must be...
-    return udx.documentElement().nodeName()=="DataExchangeInfo";
+    // File is XML; only prolog and root tag are parsed
+    QXmlStreamReader xml(sniffer.head);
+    if (!xml.readNextStartElement())
+        return FileSniffer::NotDetected;
+    // Root file tag must be...
+    if (xml.name()==QLatin1String("DataExchangeInfo"))
+        return FileSniffer::Sure;
+    return FileSniffer::NotDetected;
 }
 
 QStringList UDXFile::supportedExtensions()
@@ -52,110 +50,82 @@ bool UDXFile::importRecords(const QString &url, ContactList &list, bool append)
 {
     if (!openFile(url, QIODevice::ReadOnly))
         return false;
-    // Read XML
-    QString err_msg;
-    int err_line, err_col;
-    if (!setContent(&file, &err_msg, &err_line, &err_col)) {
-        _errors << QObject::tr("Can't read content from file %1\n%2\nline %3, col %4\n")
-            .arg(url).arg(err_msg).arg(err_line).arg(err_col);
+    // Records are built while reading, without whole document tree in memory
+    QXmlStreamReader xml(&file);
+    // Root element
+    if (!xml.readNextStartElement() || xml.name()!=QLatin1String("DataExchangeInfo")) {
+        if (xml.hasError())
+            readError(xml, url);
+        else
+            _errors << QObject::tr("Root node is not 'DataExchangeInfo' at file\n%1").arg(url);
         closeFile();
         return false;
     }
-    closeFile();
-    // Root element
-    QDomElement root = documentElement();
-    if (root.nodeName()!="DataExchangeInfo") {
-        _errors << QObject::tr("Root node is not 'DataExchangeInfo' at file\n%1").arg(url);
+    if (!append)
+        list.clear();
+    int startCount = list.count();
+    bool recInfoFound = false;
+    bool vCardFound = false;
+    QString udxVer, vcVer;
+    int expCount = 0;
+    while (xml.readNextStartElement()) {
+        if (xml.name()==QLatin1String("RecordInfo")) {
+            // Codepage, version, expected record count
+            recInfoFound = true;
+            QString charSet;
+            readRecordInfo(xml, charSet, udxVer, vcVer, expCount);
+            if (charSet.isEmpty()) {
+                _errors << QObject::tr("Warning: codepage not found, trying use UTF-8...");
+                charSet = "UTF-8";
+            }
+            if (udxVer.isEmpty()) {
+                _errors << QObject::tr("Warning: udx version not found, treat as 1.0...");
+                udxVer = "1.0";
+            }
+            // QTextCodec* codec = QTextCodec::codecForName(charSet.toLocal8Bit()); TODO not works on windows
+            list.reserveRecords(expCount);
+        }
+        else if (xml.name()==QLatin1String("vCard")) {
+            // In all known udx files RecordInfo precedes vCard set
+            if (!recInfoFound) {
+                _errors << QObject::tr("Can't find 'RecordInfo' tag at file\n%1").arg(url);
+                closeFile();
+                return false;
+            }
+            vCardFound = true;
+            while (xml.readNextStartElement()) {
+                if (xml.name()==QLatin1String("vCardInfo")) {
+                    list.push_back(ContactItem());
+                    ContactItem& item = list.last();
+                    item.originalFormat = "UDX";
+                    item.version = udxVer;
+                    item.subVersion = vcVer;
+                    readRecord(xml, item);
+                    item.calculateFields();
+                }
+                else
+                    xml.skipCurrentElement();
+            }
+        }
+        else
+            xml.skipCurrentElement();
+    }
+    if (xml.hasError()) {
+        readError(xml, url);
+        closeFile();
         return false;
     }
-    // Codepage, version, expected record count
-    QDomElement recInfo = root.firstChildElement("RecordInfo");
-    if (recInfo.isNull()) {
+    closeFile();
+    if (!recInfoFound) {
         _errors << QObject::tr("Can't find 'RecordInfo' tag at file\n%1").arg(url);
         return false;
     }
-    QString charSet = recInfo.firstChildElement("Encoding").text();
-    if (charSet.isEmpty()) {
-        _errors << QObject::tr("Warning: codepage not found, trying use UTF-8...");
-        charSet = "UTF-8";
-    }
-    QString udxVer = recInfo.firstChildElement("UdxVersion").text();
-    if (udxVer.isEmpty()) {
-        _errors << QObject::tr("Warning: udx version not found, treat as 1.0...");
-        udxVer = "1.0";
-    }
-    QDomElement vcfInfo = recInfo.firstChildElement("RecordOfvCard");
-    QString vcVer = vcfInfo.firstChildElement("vCardVersion").text();
-    int expCount = vcfInfo.firstChildElement("vCardRecord").text().toInt();
-    // vCard set
-    QDomElement vCard = root.firstChildElement("vCard");
-    if (vCard.isNull()) {
+    if (!vCardFound) {
         _errors << QObject::tr("Can't find 'vCard' records at file\n%1").arg(url);
         return false;
     }
-    // QTextCodec* codec = QTextCodec::codecForName(charSet.toLocal8Bit()); TODO not works on windows
-    ContactItem item;
-    if (!append)
-        list.clear();
-    QDomElement vCardInfo = vCard.firstChildElement("vCardInfo");
-    while (!vCardInfo.isNull()) {
-        item.clear();
-        item.originalFormat = "UDX";
-        item.version = udxVer;
-        item.subVersion = vcVer;
-        item.id = vCardInfo.firstChildElement("Sequence").text();
-        QDomElement fields = vCardInfo.firstChildElement("vCardField");
-        if (fields.isNull())
-            _errors << QObject::tr("Can't find 'vCardField' at sequence %1").arg(item.id);
-        QDomElement field = fields.firstChildElement();
-        while (!field.isNull()) {
-            QString fldName = field.nodeName().toUpper();
-            QString fldValue = field.text(); // codec->toUnicode(field.text().toLocal8Bit()); TODO not works on windows
-            if (fldName=="N") {
-                fldValue.replace("\\;", " ");
-                // In ALL known me udx files part before first ; was EMPTY
-                fldValue.remove(";");
-                item.names = fldValue.split(" ");
-                // If empty parts not in-middle, remove it
-                item.dropFinalEmptyNames();
-            }
-            else if (fldName.startsWith("TEL")) {
-                Phone phone;
-                phone.value = fldValue;
-                if (fldName=="TEL")
-                    phone.types << "CELL";
-                else if (fldName=="TELHOME")
-                    phone.types << "HOME";
-                else if (fldName=="TELWORK")
-                    phone.types << "WORK";
-                else if (fldName=="TELFAX")
-                    phone.types << "FAX";
-                else
-                    _errors << QObject::tr("Unknown phone type: %1 (%2)").arg(phone.value).arg(item.names[0]);
-                phone.syncMLRef = -1;
-                item.phones.push_back(phone);
-            }
-            else if (fldName=="ORGNAME")
-                item.organization = fldValue;
-            else if (fldName=="BDAY")
-                item.birthday.value = QDateTime::fromString(fldValue, "yyyyMMdd"); // TODO Maybe, use DateItem::fromString
-            else if (fldName=="EMAIL") {
-                Email email;
-                email.value = fldValue;
-                email.types << "pref";
-                email.syncMLRef = -1;
-                item.emails.push_back(email);
-            }
-            else
-                _errors << QObject::tr("Unknown 'vCardfield' type: %1").arg(fldName);
-            field = field.nextSiblingElement();
-        }
-        item.calculateFields();
-        list.push_back(item);
-        vCardInfo = vCardInfo.nextSiblingElement();
-    }
-    if (list.count()!=expCount)
-        _errors << QObject::tr("%1 records read, %2 expected").arg(list.count()).arg(expCount);
+    if (list.count()-startCount!=expCount)
+        _errors << QObject::tr("%1 records read, %2 expected").arg(list.count()-startCount).arg(expCount);
     // Unknown tags statistics
     int totalUnknownTags = 0;
     foreach (const ContactItem& _item, list)
@@ -166,156 +136,288 @@ bool UDXFile::importRecords(const QString &url, ContactList &list, bool append)
     return (!list.isEmpty());
 }
 
+void UDXFile::readRecordInfo(QXmlStreamReader &xml, QString &charSet, QString &udxVer, QString &vcVer, int &expCount)
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name()==QLatin1String("Encoding"))
+            charSet = xml.readElementText();
+        else if (xml.name()==QLatin1String("UdxVersion"))
+            udxVer = xml.readElementText();
+        else if (xml.name()==QLatin1String("RecordOfvCard")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name()==QLatin1String("vCardVersion"))
+                    vcVer = xml.readElementText();
+                else if (xml.name()==QLatin1String("vCardRecord"))
+                    expCount = xml.readElementText().toInt();
+                else
+                    xml.skipCurrentElement();
+            }
+        }
+        else
+            xml.skipCurrentElement();
+    }
+}
+
+void UDXFile::readRecord(QXmlStreamReader &xml, ContactItem &item)
+{
+    bool fieldsFound = false;
+    while (xml.readNextStartElement()) {
+        if (xml.name()==QLatin1String("Sequence"))
+            item.id = xml.readElementText();
+        else if (xml.name()==QLatin1String("vCardField")) {
+            fieldsFound = true;
+            while (xml.readNextStartElement()) {
+                QString fldName = xml.name().toString().toUpper();
+                QString fldValue = xml.readElementText(); // codec->toUnicode(field.text().toLocal8Bit()); TODO not works on windows
+                readField(fldName, fldValue, item);
+            }
+        }
+        else
+            xml.skipCurrentElement();
+    }
+    if (!fieldsFound)
+        _errors << QObject::tr("Can't find 'vCardField' at sequence %1").arg(item.id);
+}
+
+void UDXFile::readField(const QString &fldName, QString &fldValue, ContactItem &item)
+{
+    if (fldName=="N") {
+        fldValue.replace("\\;", " ");
+        // In ALL known me udx files part before first ; was EMPTY
+        fldValue.remove(";");
+        item.names = fldValue.split(" ");
+        // If empty parts not in-middle, remove it
+        item.dropFinalEmptyNames();
+    }
+    else if (fldName.startsWith("TEL")) {
+        Phone phone;
+        phone.value = fldValue;
+        if (fldName=="TEL")
+            phone.types << "CELL";
+        else if (fldName=="TELHOME")
+            phone.types << "HOME";
+        else if (fldName=="TELWORK")
+            phone.types << "WORK";
+        else if (fldName=="TELFAX")
+            phone.types << "FAX";
+        else
+            _errors << QObject::tr("Unknown phone type: %1 (%2)").arg(phone.value).arg(item.names.value(0));
+        phone.syncMLRef = -1;
+        item.phones.push_back(phone);
+    }
+    else if (fldName=="ORGNAME")
+        item.organization = fldValue;
+    else if (fldName=="BDAY")
+        item.birthday.value = QDateTime::fromString(fldValue, "yyyyMMdd"); // TODO Maybe, use DateItem::fromString
+    else if (fldName=="EMAIL") {
+        Email email;
+        email.value = fldValue;
+        email.types << "pref";
+        email.syncMLRef = -1;
+        item.emails.push_back(email);
+    }
+    else
+        _errors << QObject::tr("Unknown 'vCardfield' type: %1").arg(fldName);
+}
+
+void UDXFile::readError(QXmlStreamReader &xml, const QString &url)
+{
+    _errors << QObject::tr("Can't read content from file %1\n%2\nline %3, col %4\n")
+        .arg(url).arg(xml.errorString()).arg(xml.lineNumber()).arg(xml.columnNumber());
+}
+
 bool UDXFile::exportRecords(const QString &url, ContactList &list)
 {
-    QDomDocument::clear();
-    QDomElement root = createElement("DataExchangeInfo");
-    appendChild(root);
     // Original format also was UDX?
     bool wasUDX = false;
     if (!list.isEmpty())
         if (list[0].originalFormat=="UDX")
             wasUDX = true;
-    // XML header
-    QDomNode node = createProcessingInstruction("xml", "version=\"1.0\" encoding=\"utf-8\"");
-    insertBefore(node, firstChild());
-    // UDX header
-    QDomElement recInfo = addElement(root, "RecordInfo");
-    addElement(recInfo, "VendorInfo", "VendorUDX");
-    addElement(recInfo, "DeviceInfo", "DeviceUDX");
-    if (wasUDX)
-        addElement(recInfo, "UdxVersion", list[0].version);
-    else
-        addElement(recInfo, "UdxVersion", "1.0");
-    addElement(recInfo, "UserAgent", "AgentUDX");
-    addElement(recInfo, "UserInfo", "UserUDX");
-    addElement(recInfo, "Encoding", "UTF-8");
-    addElement(recInfo, "FileSize", "          "); // strongly 10 spaces! (~~)
-    addElement(recInfo, "Date", QDate::currentDate().toString("dd.MM.yyyy"));
-    addElement(recInfo, "Language","CHS"); // wtf, but this code was in real russian-language udx
-    QDomElement vcfInfo = addElement(recInfo, "RecordOfvCard");
-    if (wasUDX)
-        addElement(vcfInfo, "vCardVersion", list[0].subVersion);
-    else
-        addElement(vcfInfo, "vCardVersion", "2.1");
-    addElement(vcfInfo, "vCardRecord", QString::number(list.count()));
-    addElement(vcfInfo, "vCardLength", "          "); // strongly 10 spaces! (~~)
-    addElement(recInfo, "RecordOfvCalendar");
-    addElement(recInfo, "RecordOfSMS");
-    addElement(recInfo, "RecordOfMMS");
-    addElement(recInfo, "RecordOfEmail");
-    // Parent tag for all records
-    QDomElement vCard = addElement(root, "vCard");
     // Add missing sequences to records
-    int maxSeq = 0;
     if (wasUDX) { // wasUDX - simply add missing
-        foreach (const ContactItem& item, list)
-            if (item.id.toInt()>maxSeq)
-                    maxSeq = item.id.toInt();
-        QSet<int> seqs;
+        int maxSeq = 0;
+        for (int i=0; i<list.count(); i++) {
+            ContactItem& item = list[i];
+            int currentID = item.id.toInt();
+            if (currentID>0) // normalize, so "01" and "1" will be duplicates
+                item.id = QString::number(currentID);
+            if (currentID>maxSeq)
+                maxSeq = currentID;
+        }
+        list.setIdIndexEnabled(true);
         for (int i=0; i<list.count(); i++) {
             ContactItem& item = list[i];
             int currentID = item.id.toInt();
             if (currentID<1) // simply missing
                 item.id = QString::number(++maxSeq);
-            if (seqs.contains(currentID)) { // duplicate?
+            else if (list.findById(item.id)!=i) { // duplicate?
                 _errors << QObject::tr("Warning: contact %1, duplicate id %2 changed to %3")
-                     .arg(item.visibleName).arg(currentID).arg(++maxSeq);
+                     .arg(item.visibleName()).arg(currentID).arg(++maxSeq);
                 item.id = QString::number(maxSeq);
             }
-            seqs.insert(item.id.toInt());
+            // New id is greater than all others, so index remains valid for them
         }
+        list.setIdIndexEnabled(false);
     }
     else { // if original wasn't UDX, completely renumerate all
         for (int i=0; i<list.count(); i++)
             list[i].id = QString::number(i+1);
-        maxSeq = list.count();
     }
+    // Sort records by id
+    QList<QPair<int, int> > order; // sequence, index
+#if QT_VERSION >= 0x040700
+    order.reserve(list.count());
+#endif
+    for (int i=0; i<list.count(); i++)
+        order << qMakePair(list[i].id.toInt(), i);
+    qSort(order);
+    if (!openSink(url))
+        return false;
+    // Records are written directly to file, without document tree in memory
+    QIODevice* out = sink.device();
+    QXmlStreamWriter xml(out);
+#if QT_VERSION < 0x060000
+    xml.setCodec("UTF-8");
+#endif
+    // Line breaks are written explicitly (not by auto formatting),
+    // so file positions of tags are known exactly
+    xml.writeStartDocument();
+    xml.writeCharacters("\n");
+    startElement(xml, "DataExchangeInfo");
+    // UDX header
+    startElement(xml, "RecordInfo");
+    addElement(xml, "VendorInfo", "VendorUDX");
+    addElement(xml, "DeviceInfo", "DeviceUDX");
+    if (wasUDX)
+        addElement(xml, "UdxVersion", list[0].version);
+    else
+        addElement(xml, "UdxVersion", "1.0");
+    addElement(xml, "UserAgent", "AgentUDX");
+    addElement(xml, "UserInfo", "UserUDX");
+    addElement(xml, "Encoding", "UTF-8");
+    qint64 fileSizePos = addPlaceholder(xml, "FileSize");
+    addElement(xml, "Date", QDate::currentDate().toString("dd.MM.yyyy"));
+    addElement(xml, "Language","CHS"); // wtf, but this code was in real russian-language udx
+    startElement(xml, "RecordOfvCard");
+    if (wasUDX)
+        addElement(xml, "vCardVersion", list[0].subVersion);
+    else
+        addElement(xml, "vCardVersion", "2.1");
+    addElement(xml, "vCardRecord", QString::number(list.count()));
+    qint64 vCardLengthPos = addPlaceholder(xml, "vCardLength");
+    endElement(xml); // RecordOfvCard
+    addElement(xml, "RecordOfvCalendar");
+    addElement(xml, "RecordOfSMS");
+    addElement(xml, "RecordOfMMS");
+    addElement(xml, "RecordOfEmail");
+    endElement(xml); // RecordInfo
+    // Parent tag for all records
+    qint64 vCardStart = out->pos();
+    startElement(xml, "vCard");
     // Write all records, sorted by id
-    for(int i=1; i<=maxSeq; i++) {
-        int index = list.findById(QString::number(i));
-        if (index==-1)
-            continue;
-        ContactItem& item = list[index];
-        QDomElement vCardInfo = addElement(vCard, "vCardInfo");
-        addElement(vCardInfo, "Sequence", item.id);
-        QDomElement vCardField = addElement(vCardInfo, "vCardField");
+    for (int i=0; i<order.count(); i++) {
+        ContactItem& item = list[order[i].second];
+        startElement(xml, "vCardInfo");
+        addElement(xml, "Sequence", item.id);
+        startElement(xml, "vCardField");
         // Names
-        addElement(vCardField, "N", QString(";")+item.names.join(" ")); // sad but true
+        addElement(xml, "N", QString(";")+item.names.join(" ")); // sad but true
         // Phones
         foreach (const Phone& ph, item.phones) {
             if (ph.types.contains("CELL", Qt::CaseInsensitive))
-                addElement(vCardField, "TEL", ph.value);
+                addElement(xml, "TEL", ph.value);
             else if (ph.types.contains("HOME", Qt::CaseInsensitive))
-                addElement(vCardField, "TELHOME", ph.value);
+                addElement(xml, "TELHOME", ph.value);
             else if (ph.types.contains("WORK", Qt::CaseInsensitive))
-                addElement(vCardField, "TELWORK", ph.value);
+                addElement(xml, "TELWORK", ph.value);
             else if (ph.types.contains("FAX", Qt::CaseInsensitive))
-                addElement(vCardField, "TELFAX", ph.value);
+                addElement(xml, "TELFAX", ph.value);
             else if (ph.types.join(";").toUpper()!="PREF") {
-                addElement(vCardField, "TEL", ph.value);
+                addElement(xml, "TEL", ph.value);
                 _errors << QObject::tr("Warning: contact %1, unknown tel type:\n%2\n saved as cellular")
-                     .arg(item.visibleName).arg(ph.types.join(";"));
+                     .arg(item.visibleName()).arg(ph.types.join(";"));
             }
         }
         // Emails
         foreach (const Email& em, item.emails)
-            addElement(vCardField, "EMAIL", em.value);
+            addElement(xml, "EMAIL", em.value);
         // TODO what if save some EMAIL tags? (also some one-type TEL)
         // Organization/title
         if (!item.organization.isEmpty()) {
             QString org = item.organization;
             if (!item.title.isEmpty())
                 org += ", " + item.title;
-            addElement(vCardField, "ORGNAME", org);
+            addElement(xml, "ORGNAME", org);
         }
         // Birthday
         if (item.birthday.value.isValid())
-            addElement(vCardField, "BDAY", item.birthday.toString(DateItem::ISOBasic));
+            addElement(xml, "BDAY", item.birthday.toString(DateItem::ISOBasic));
         // TODO maybe some phones support time in udx? need search specs, and maybe need use DateItem::toString() here
         // but check format, - and T, maybe it's vCard 2.1
         if (item.birthday.hasTime)
             _errors << QObject::tr("Warning: contact %1 has time (%2) in birthday, not implemented in UDX reader")
-                 .arg(item.visibleName).arg(item.birthday.value.toString("hh:mm:ss"));
+                 .arg(item.visibleName()).arg(item.birthday.value.toString("hh:mm:ss"));
         if (!item.addrs.isEmpty())
             _errors << QObject::tr("Warning: contact %1 has address(es), not implemented in UDX")
-                 .arg(item.visibleName);
+                 .arg(item.visibleName());
         if (!item.photo.isEmpty())
-            _errors << QObject::tr("Warning: contact %1 has photo, not implemented in UDX").arg(item.visibleName);
+            _errors << QObject::tr("Warning: contact %1 has photo, not implemented in UDX").arg(item.visibleName());
         if (!item.description.isEmpty())
-            _errors << QObject::tr("Warning: contact %1 has description, not implemented in UDX").arg(item.visibleName);
+            _errors << QObject::tr("Warning: contact %1 has description, not implemented in UDX").arg(item.visibleName());
         if (!item.title.isEmpty())
-            _errors << QObject::tr("Warning: contact %1 has job title, not implemented in UDX").arg(item.visibleName);
+            _errors << QObject::tr("Warning: contact %1 has job title, not implemented in UDX").arg(item.visibleName());
         if (!item.anniversaries.isEmpty())
-            _errors << QObject::tr("Warning: contact %1 has anniversaries, not implemented in UDX").arg(item.visibleName);
+            _errors << QObject::tr("Warning: contact %1 has anniversaries, not implemented in UDX").arg(item.visibleName());
         // Here place warning on all other udx-unsupported things
+        endElement(xml); // vCardField
+        endElement(xml); // vCardInfo
     }
-    QString content = toString(0);
-    // Add left-aligned file size, completed to 10 characters
-    int fsPos = content.indexOf("<FileSize>")+QString("<FileSize>").length();
-    int fileSize = content.toLocal8Bit().size();
-    content.replace(fsPos, 10, QString("%1").arg(fileSize, -10, 10, QChar(' ')));
-    // Add left-aligned vcard length, completed to 10 characters
-    int vclPos = content.indexOf("<vCardLength>")+QString("<vCardLength>").length();
-    int vcLength = content.indexOf("</vCard>")-content.indexOf("<vCard>")+QString("</vCard>").length();
-    content.replace(vclPos, 10, QString("%1").arg(vcLength, -10, 10, QChar(' ')));
-    // Write to file
-    if (!openFile(url, QIODevice::WriteOnly))
-        return false;
-    QTextStream stream(&file);
-    stream.setCodec("UTF-8");
-    stream << content;
-    closeFile();
-    return true;
+    xml.writeEndElement(); // vCard
+    qint64 vCardLength = out->pos()-vCardStart;
+    xml.writeCharacters("\n");
+    xml.writeEndDocument(); // DataExchangeInfo and final line break
+    // Left-aligned file size and vCard length (in bytes), completed to 10 characters
+    qint64 fileSize = out->pos();
+    writeValue(fileSizePos, fileSize);
+    writeValue(vCardLengthPos, vCardLength);
+    return closeSink(); // write errors are detected here
 }
 
-QDomElement UDXFile::addElement(QDomElement &parent, const QString &tagName, const QString &tagValue)
+void UDXFile::startElement(QXmlStreamWriter &xml, const QString &tagName)
 {
-    QDomElement e = createElement(tagName);
-    if (!tagValue.isEmpty()) {
-        QDomText t = createTextNode(tagValue);
-        e.appendChild(t);
-    }
-    parent.appendChild(e);
-    return e;
+    xml.writeStartElement(tagName);
+    xml.writeCharacters("\n");
+}
+
+void UDXFile::endElement(QXmlStreamWriter &xml)
+{
+    xml.writeEndElement();
+    xml.writeCharacters("\n");
+}
+
+void UDXFile::addElement(QXmlStreamWriter &xml, const QString &tagName, const QString &tagValue)
+{
+    if (tagValue.isEmpty())
+        xml.writeEmptyElement(tagName);
+    else
+        xml.writeTextElement(tagName, tagValue);
+    xml.writeCharacters("\n");
+}
+
+qint64 UDXFile::addPlaceholder(QXmlStreamWriter &xml, const QString &tagName)
+{
+    xml.writeStartElement(tagName);
+    xml.writeCharacters(""); // close start tag
+    qint64 pos = sink.device()->pos();
+    xml.writeCharacters(QString(UDX_NUM_FIELD_LEN, QChar(' '))); // strongly 10 spaces! (~~)
+    endElement(xml);
+    return pos;
+}
+
+void UDXFile::writeValue(qint64 pos, qint64 value)
+{
+    QByteArray data = QString("%1").arg(value, -UDX_NUM_FIELD_LEN, 10, QChar(' ')).toLatin1();
+    QIODevice* out = sink.device();
+    if (out->seek(pos))
+        out->write(data.left(UDX_NUM_FIELD_LEN));
 }
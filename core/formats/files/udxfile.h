@@ -15,21 +15,31 @@
 #define UDXFILE_H
 
 
-#include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include "fileformat.h"
+#include "filesniffer.h"
 
-class UDXFile : public FileFormat, QDomDocument
+class UDXFile : public FileFormat
 {
 public:
     UDXFile();
     // IFormat interface
-    static bool detect(const QString &url);
+    static int detect(const FileSniffer& sniffer);
     static QStringList supportedExtensions();
     static QStringList supportedFilters();
     bool importRecords(const QString &url, ContactList &list, bool append);
     bool exportRecords(const QString &url, ContactList &list);
 private:
-    QDomElement addElement(QDomElement& parent, const QString& tagName, const QString& tagValue = "");
+    void readRecordInfo(QXmlStreamReader& xml, QString& charSet, QString& udxVer, QString& vcVer, int& expCount);
+    void readRecord(QXmlStreamReader& xml, ContactItem& item);
+    void readField(const QString& fldName, QString& fldValue, ContactItem& item);
+    void readError(QXmlStreamReader& xml, const QString& url);
+    void startElement(QXmlStreamWriter& xml, const QString& tagName);
+    void endElement(QXmlStreamWriter& xml);
+    void addElement(QXmlStreamWriter& xml, const QString& tagName, const QString& tagValue = "");
+    qint64 addPlaceholder(QXmlStreamWriter& xml, const QString& tagName); // returns value position
+    void writeValue(qint64 pos, qint64 value);
 };
 
 #endif // UDXFILE_H
@@ -0,0 +1,203 @@
+/* Double Contact
+ *
+ * Module: Zip archive of VCard files (one file per contact) export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+#include <QCryptographicHash>
+#include <QObject>
+#include <QRunnable>
+#include <QStringList>
+#include <QVector>
+#include "globals.h"
+#include "vcfarchive.h"
+#include "vcfdirectory.h"
+#include "zipvcardreader.h"
+#include "quazip.h"
+#include "quazipfile.h"
+#include "zlib.h"
+#include "../common/vcarddata.h"
+
+// Entries are serialized and deflated by jobs; for small lists
+// single job runs in calling thread
+#define VCF_ARCHIVE_MIN_JOB_ENTRIES 64
+#define VCF_ARCHIVE_SUFFIX ".vcf"
+
+// Compressed entry, ready to be stored in archive as is
+struct VCFArchiveEntry {
+    QByteArray data;
+    QByteArray hash; // SHA-1 of uncompressed content, for file name
+    quint32 crc;
+    ulong size;
+};
+
+// Serializes and deflates records [from, to)
+class VCFArchiveCompressor : public QRunnable
+{
+public:
+    VCFArchiveCompressor(const ContactList& list, VCFArchiveEntry* entries, int from, int to)
+        :list(list), entries(entries), from(from), to(to)
+    {
+        setAutoDelete(false);
+    }
+    void run();
+    QStringList errors;
+    QString fatalError;
+private:
+    const ContactList& list;
+    VCFArchiveEntry* entries; // array for all records, each job fills own range
+    int from, to;
+};
+
+void VCFArchiveCompressor::run()
+{
+    VCardData data;
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    // Negative window bits means raw deflate data, as stored in zip
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)!=Z_OK) {
+        fatalError = QObject::tr("Can't initialize compression");
+        return;
+    }
+    for (int i=from; i<to; i++) {
+        VCFArchiveEntry& entry = entries[i];
+        QByteArray content = VCFDirectory::serializeRecord(data, list[i], errors);
+        entry.hash = QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+        entry.crc = crc32(0L, (const Bytef*)content.constData(), content.size());
+        entry.size = content.size();
+        entry.data.resize(deflateBound(&zs, content.size()));
+        zs.next_in = (Bytef*)content.data();
+        zs.avail_in = content.size();
+        zs.next_out = (Bytef*)entry.data.data();
+        zs.avail_out = entry.data.size();
+        // deflateBound() guarantees that single call is enough
+        if (deflate(&zs, Z_FINISH)!=Z_STREAM_END) {
+            fatalError = QObject::tr("Can't compress %1").arg(list[i].visibleName());
+            break;
+        }
+        entry.data.resize(entry.data.size()-zs.avail_out);
+        deflateReset(&zs);
+    }
+    deflateEnd(&zs);
+}
+
+VCFArchive::VCFArchive()
+    :FileFormat()
+{
+}
+
+int VCFArchive::detect(const FileSniffer &sniffer)
+{
+    // Check if file is zip archive with vCard files in root
+    if (!sniffer.isZip)
+        return FileSniffer::NotDetected;
+    QStringList entries = sniffer.zipEntries;
+    if (!sniffer.zipDirRead) { // i.e. zip64; let QuaZip read it
+        QuaZip zip(sniffer.url);
+        if (!zip.open(QuaZip::mdUnzip))
+            return FileSniffer::NotDetected;
+        entries = zip.getFileNameList();
+        zip.close();
+    }
+    foreach (const QString& entry, entries)
+        if (!entry.contains('/') && entry.endsWith(VCF_ARCHIVE_SUFFIX, Qt::CaseInsensitive))
+            return FileSniffer::Exact;
+    return FileSniffer::NotDetected;
+}
+
+QStringList VCFArchive::supportedExtensions()
+{
+    return (QStringList() << "zip" << "ZIP");
+}
+
+QStringList VCFArchive::supportedFilters()
+{
+    return (QStringList() << "vCard zip archive (*.zip *.ZIP)");
+}
+
+bool VCFArchive::importRecords(const QString &url, ContactList &list, bool append)
+{
+    ContactList items;
+    ZipVCardReader reader;
+    bool res = reader.read(url, "", VCF_ARCHIVE_SUFFIX, items);
+    _errors << reader.errors;
+    if (!res) {
+        _fatalError = reader.fatalError;
+        return false;
+    }
+    if (reader.entryCount==0) {
+        _fatalError = QObject::tr("Archive not contains VCF files:\n%1").arg(url);
+        return false;
+    }
+    if (!append) list.clear();
+    list.appendRecords(items);
+    return true;
+}
+
+bool VCFArchive::exportRecords(const QString &url, ContactList &list)
+{
+    _errors.clear();
+    // Serialize and deflate in parallel...
+    list.updateFields(); // jobs read calculated fields
+    const int count = list.count();
+    QVector<VCFArchiveEntry> entries(count);
+    const int chunk = jobChunkSize(count, VCF_ARCHIVE_MIN_JOB_ENTRIES);
+    QList<VCFArchiveCompressor*> compressors;
+    for (int from=0; from<count; from+=chunk)
+        compressors << new VCFArchiveCompressor(list, entries.data(), from, qMin(from+chunk, count));
+    runJobs(compressors);
+    foreach (VCFArchiveCompressor* compressor, compressors) {
+        _errors << compressor->errors;
+        if (_fatalError.isEmpty())
+            _fatalError = compressor->fatalError;
+    }
+    qDeleteAll(compressors);
+    if (!_fatalError.isEmpty())
+        return false;
+    // ...then store already compressed entries in calling thread
+    QVector<QByteArray> hashes(count);
+    for (int i=0; i<count; i++)
+        hashes[i] = entries[i].hash;
+    const QStringList fileNames = VCFDirectory::recordFileNames(list, hashes);
+    if (!openSink(url))
+        return false;
+    QuaZip zip(sink.device());
+    // Sink commits file itself; zip64 allows huge books
+    zip.setAutoClose(false);
+    zip.setZip64Enabled(true);
+    if (!zip.open(QuaZip::mdCreate)) {
+        sink.cancel();
+        _fatalError = S_WRITE_ERR.arg(url);
+        return false;
+    }
+    bool res = true;
+    for (int i=0; i<count && res; i++) {
+        VCFArchiveEntry& entry = entries[i];
+        QuaZipNewInfo info(fileNames[i]);
+        info.uncompressedSize = entry.size;
+        QuaZipFile vcf(&zip);
+        res = vcf.open(QIODevice::WriteOnly, info, NULL, entry.crc,
+            Z_DEFLATED, Z_DEFAULT_COMPRESSION, true);
+        if (res) {
+            res = vcf.write(entry.data)==entry.data.size();
+            vcf.close();
+            res = res && vcf.getZipError()==ZIP_OK;
+        }
+        entry.data.clear(); // don't keep already stored data
+    }
+    zip.close();
+    if (!res || zip.getZipError()!=ZIP_OK) {
+        sink.cancel();
+        _fatalError = S_WRITE_ERR.arg(url);
+        return false;
+    }
+    return closeSink();
+}
@@ -0,0 +1,35 @@
+/* Double Contact
+ *
+ * Module: Zip archive of VCard files (one file per contact) export/import
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef VCFARCHIVE_H
+#define VCFARCHIVE_H
+
+#include "fileformat.h"
+#include "filesniffer.h"
+
+// Same files as in VCFDirectory, but in archive root
+class VCFArchive : public FileFormat
+{
+public:
+    VCFArchive();
+
+    // IFormat interface
+public:
+    static int detect(const FileSniffer& sniffer);
+    static QStringList supportedExtensions();
+    static QStringList supportedFilters();
+    bool importRecords(const QString &url, ContactList &list, bool append);
+    bool exportRecords(const QString &url, ContactList &list);
+};
+
+#endif // VCFARCHIVE_H
@@ -11,13 +11,133 @@
  *
  */
 #include "vcfdirectory.h"
+#include <QCryptographicHash>
 #include <QDir>
+#include <QHash>
+#include <QRunnable>
+#include <QSet>
 #include <QStringList>
 #include <QTextStream>
 
 #include "globals.h"
 #include "../common/vcarddata.h"
 
+// Files are read and written by jobs; for small directories
+// single job runs in calling thread
+#define VCF_DIR_MIN_JOB_FILES 64
+// Export state: hashes of written files, to rewrite only changed ones
+#define VCF_DIR_MANIFEST ".doublecontact-manifest"
+#define VCF_DIR_MAX_ID_LEN 64
+#define VCF_DIR_HASH_NAME_LEN 16
+// File names of versions before manifest: 0001.vcf, 0002.vcf, etc.
+#define VCF_DIR_LEGACY_DIGITS 4
+
+// Reads and parses files [from, to)
+class VCFDirReader : public QRunnable
+{
+public:
+    VCFDirReader(const QString& url, const QStringList& entries, int from, int to)
+        :url(url), entries(entries), from(from), to(to)
+    {
+        setAutoDelete(false);
+    }
+    void run();
+    ContactList items;
+    QStringList errors;
+    QString fatalError;
+private:
+    QString url;
+    const QStringList& entries;
+    int from, to;
+};
+
+void VCFDirReader::run()
+{
+    VCardData data; // VCardData keeps per-property state, so it isn't shared between jobs
+    items.reserveRecords(to-from);
+    for (int i=from; i<to; i++) {
+        QFile file(url + QDir::separator() + entries[i]);
+        if (!file.open(QIODevice::ReadOnly)) {
+            fatalError = S_READ_ERR.arg(file.fileName());
+            return;
+        }
+        QByteArray raw = file.readAll();
+        file.close();
+        QStringList content;
+        QTextStream stream(raw);
+        do {
+            content.push_back(stream.readLine());
+        } while (!stream.atEnd());
+        // Append one contact to list!
+        data.importRecords(content, items, true, errors);
+    }
+}
+
+// Serializes records [from, to) and calculates hashes of result
+class VCFDirSerializer : public QRunnable
+{
+public:
+    VCFDirSerializer(const ContactList& list, QByteArray* contents, QByteArray* hashes, int from, int to)
+        :list(list), contents(contents), hashes(hashes), from(from), to(to)
+    {
+        setAutoDelete(false);
+    }
+    void run();
+    QStringList errors;
+private:
+    const ContactList& list;
+    QByteArray *contents, *hashes; // arrays for all records, each job fills own range
+    int from, to;
+};
+
+void VCFDirSerializer::run()
+{
+    VCardData data;
+    for (int i=from; i<to; i++) {
+        contents[i] = VCFDirectory::serializeRecord(data, list[i], errors);
+        hashes[i] = QCryptographicHash::hash(contents[i], QCryptographicHash::Sha1).toHex();
+    }
+}
+
+// Writes files [from, to) of given list
+class VCFDirWriter : public QRunnable
+{
+public:
+    VCFDirWriter(const QStringList& fileNames, const QVector<QByteArray>& contents,
+        const QVector<int>& changed, int from, int to)
+        :fileNames(fileNames), contents(contents), changed(changed), from(from), to(to)
+    {
+        setAutoDelete(false);
+    }
+    void run();
+    QString fatalError;
+private:
+    const QStringList& fileNames;
+    const QVector<QByteArray>& contents;
+    const QVector<int>& changed; // record indexes
+    int from, to;
+};
+
+void VCFDirWriter::run()
+{
+    // Plain files, not OutputSink: its sync on each commit would cost
+    // one disk flush per record. Manifest is written after all files
+    for (int i=from; i<to; i++) {
+        const int index = changed[i];
+        QFile file(fileNames[index]);
+        bool res = file.open(QIODevice::WriteOnly);
+        if (res) {
+            res = (file.write(contents[index])==contents[index].size());
+            file.close();
+            res = res && (file.error()==QFile::NoError);
+        }
+        if (!res) {
+            fatalError = S_WRITE_ERR.arg(fileNames[index]);
+            return;
+        }
+    }
+}
+
 VCFDirectory::VCFDirectory()
     :FileFormat()
 {
@@ -40,45 +160,243 @@ bool VCFDirectory::importRecords(const QString &url, ContactList &list, bool app
         _fatalError =  QObject::tr("Directory not contains VCF files:\n%1").arg(url);
         return false;
     }
-    VCardData data;
     _errors.clear();
-    foreach (const QString& fileName, entries) {
-        if (!openFile(url + QDir::separator() + fileName, QIODevice::ReadOnly))
-            return false;
-        QStringList content;
-        QTextStream stream(&file);
-        do {
-            content.push_back(stream.readLine());
-        } while (!stream.atEnd());
-        closeFile();
-        // Append one contact to list!
-        data.importRecords(content, list, true, _errors);
+    const int chunk = jobChunkSize(entries.count(), VCF_DIR_MIN_JOB_FILES);
+    QList<VCFDirReader*> readers;
+    for (int from=0; from<entries.count(); from+=chunk)
+        readers << new VCFDirReader(url, entries, from, qMin(from+chunk, entries.count()));
+    runJobs(readers);
+    // On any fatal error, nothing is merged, so caller doesn't get half-loaded list
+    bool res = true;
+    foreach (VCFDirReader* reader, readers) {
+        _errors << reader->errors;
+        if (res && !reader->fatalError.isEmpty()) {
+            _fatalError = reader->fatalError;
+            res = false;
+        }
     }
+    if (!res) {
+        qDeleteAll(readers);
+        return false;
+    }
+    // Merge in file name order
+    list.reserveRecords(entries.count());
+    foreach (VCFDirReader* reader, readers)
+        foreach (const ContactItem& item, reader->items)
+            list.push_back(item);
+    qDeleteAll(readers);
     return true;
 }
 
 bool VCFDirectory::exportRecords(const QString &url, ContactList &list)
 {
-    QDir d;
-    d.rmpath(url);
+    QDir d(url);
     if (!d.mkpath(url)) {
         _fatalError = QObject::tr("Can't create directory\n%1").arg(url);
         return false;
     }
-    int i = 1;
-    VCardData data;
-    foreach(const ContactItem& item, list) {
-        // TODO use id, if present, in filename?
-        QString fileName = url + QDir::separator() + QString("%1.vcf").arg((uint)i, 4, 10, QChar('0'));
-        QStringList content;
-        data.exportRecord(content, item, _errors);
-        if (!openFile(fileName, QIODevice::WriteOnly))
+    _errors.clear();
+    // Previous export state
+    Manifest previous;
+    bool hasManifest = readManifest(url, previous);
+    QHash<QString, QByteArray> previousHashes;
+    foreach (const ManifestEntry& entry, previous)
+        previousHashes.insert(entry.fileName, entry.hash);
+    QSet<QString> existing
+        = QSet<QString>::fromList(d.entryList(QStringList("*.vcf"), QDir::Files));
+    // Serialize
+    list.updateFields(); // jobs read calculated fields
+    const int count = list.count();
+    QVector<QByteArray> contents(count);
+    QVector<QByteArray> hashes(count);
+    const int chunk = jobChunkSize(count, VCF_DIR_MIN_JOB_FILES);
+    QList<VCFDirSerializer*> serializers;
+    for (int from=0; from<count; from+=chunk)
+        serializers << new VCFDirSerializer(list, contents.data(), hashes.data(),
+            from, qMin(from+chunk, count));
+    runJobs(serializers);
+    foreach (VCFDirSerializer* serializer, serializers)
+        _errors << serializer->errors;
+    qDeleteAll(serializers);
+    // Stable file names; only new and changed files will be written
+    const QStringList shortNames = recordFileNames(list, hashes, previous);
+    QStringList fileNames;
+    QSet<QString> usedNames; // lower case, for case-insensitive file systems
+    QVector<int> changed;
+    for (int i=0; i<count; i++) {
+        const QString& name = shortNames[i];
+        usedNames.insert(name.toLower());
+        fileNames << url + QDir::separator() + name;
+        if (!existing.contains(name) || previousHashes.value(name)!=hashes[i])
+            changed << i;
+    }
+    const int changedChunk = jobChunkSize(changed.count(), VCF_DIR_MIN_JOB_FILES);
+    QList<VCFDirWriter*> writers;
+    for (int from=0; from<changed.count(); from+=changedChunk)
+        writers << new VCFDirWriter(fileNames, contents, changed,
+            from, qMin(from+changedChunk, changed.count()));
+    runJobs(writers);
+    bool res = true;
+    foreach (VCFDirWriter* writer, writers)
+        if (res && !writer->fatalError.isEmpty()) {
+            _fatalError = writer->fatalError;
+            res = false;
+        }
+    qDeleteAll(writers);
+    if (!res)
+        return false;
+    // Remove files of deleted records. Only files listed in manifest are ours;
+    // without manifest, only names written by previous versions (0001.vcf, 0002.vcf, etc.)
+    // are removed, other files in directory can be user's own
+    QStringList oldNames;
+    if (hasManifest)
+        oldNames = previousHashes.keys();
+    else
+        foreach (const QString& name, existing)
+            if (isLegacyFileName(name))
+                oldNames << name;
+    foreach (const QString& oldName, oldNames)
+        if (!usedNames.contains(oldName.toLower()) && existing.contains(oldName)
+                && !d.remove(oldName))
+            _errors << QObject::tr("Can't remove file\n%1").arg(url + QDir::separator() + oldName);
+    if (!writeManifest(url, list, shortNames, hashes))
+        _errors << S_WRITE_ERR.arg(url + QDir::separator() + VCF_DIR_MANIFEST);
+    return true;
+}
+
+QByteArray VCFDirectory::serializeRecord(VCardData &data, const ContactItem &item, QStringList &errors)
+{
+    QStringList lines;
+    data.exportRecord(lines, item, errors);
+    QByteArray res;
+    QTextStream stream(&res, QIODevice::WriteOnly);
+    foreach (const QString& line, lines)
+        stream << line << "\r\n";
+    stream.flush();
+    return res;
+}
+
+QStringList VCFDirectory::recordFileNames(const ContactList &list, const QVector<QByteArray> &hashes)
+{
+    return recordFileNames(list, hashes, Manifest());
+}
+
+QStringList VCFDirectory::recordFileNames(const ContactList &list, const QVector<QByteArray> &hashes,
+    const Manifest &previous)
+{
+    const int count = list.count();
+    QVector<QString> names(count);
+    QSet<QString> usedNames; // lower case, for case-insensitive file systems
+    // Id is stable while record is edited
+    for (int i=0; i<count; i++)
+        if (!list[i].id.isEmpty())
+            names[i] = uniqueFileName(idFileNameBase(list[i].id), usedNames);
+    // Records without id keep files of previous export: unchanged records
+    // are found by content hash, edited ones by name key
+    QHash<QByteArray, QList<int> > byHash, byNameKey; // previous entries without id
+    for (int j=0; j<previous.count(); j++)
+        if (!previous[j].nameKey.isEmpty()) {
+            byHash[previous[j].hash] << j;
+            byNameKey[previous[j].nameKey] << j;
+        }
+    QVector<bool> claimed(previous.count(), false);
+    for (int pass=0; pass<2; pass++)
+        for (int i=0; i<count; i++) {
+            if (!list[i].id.isEmpty() || !names[i].isEmpty())
+                continue;
+            QList<int>& candidates = (pass==0) ? byHash[hashes[i]] : byNameKey[recordNameKey(list[i])];
+            while (!candidates.isEmpty()) {
+                int j = candidates.takeFirst();
+                const QString& name = previous[j].fileName;
+                if (!claimed[j] && !usedNames.contains(name.toLower())) {
+                    claimed[j] = true;
+                    usedNames.insert(name.toLower());
+                    names[i] = name;
+                    break;
+                }
+            }
+        }
+    // New records without id (or with changed name) are named by content hash
+    QStringList res;
+    for (int i=0; i<count; i++) {
+        if (names[i].isEmpty())
+            names[i] = uniqueFileName(QString::fromLatin1(hashes[i].left(VCF_DIR_HASH_NAME_LEN)), usedNames);
+        res << names[i];
+    }
+    return res;
+}
+
+QString VCFDirectory::uniqueFileName(const QString &baseName, QSet<QString> &usedNames)
+{
+    QString name = baseName + ".vcf";
+    for (int n=2; usedNames.contains(name.toLower()); n++)
+        name = QString("%1-%2.vcf").arg(baseName).arg(n);
+    usedNames.insert(name.toLower());
+    return name;
+}
+
+QString VCFDirectory::idFileNameBase(const QString &id)
+{
+    QString res;
+    foreach (const QChar& c, id.left(VCF_DIR_MAX_ID_LEN)) {
+        if ((c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') || c=='-' || c=='_')
+            res += c;
+        else
+            res += '_';
+    }
+    return res;
+}
+
+bool VCFDirectory::isLegacyFileName(const QString &name)
+{
+    const int digits = name.length()-4;
+    if (digits<VCF_DIR_LEGACY_DIGITS || !name.endsWith(".vcf"))
+        return false;
+    for (int i=0; i<digits; i++)
+        if (!name[i].isDigit())
             return false;
-        QTextStream stream(&file);
-        foreach (const QString line, content)
-            stream << line << (char)13 << endl;
-        closeFile();
-        i++;
+    return true;
+}
+
+QByteArray VCFDirectory::recordNameKey(const ContactItem &item)
+{
+    QString names = item.fullName + '\n' + item.names.join("\n");
+    return QCryptographicHash::hash(names.toUtf8(), QCryptographicHash::Sha1)
+        .toHex().left(VCF_DIR_HASH_NAME_LEN);
+}
+
+bool VCFDirectory::readManifest(const QString &url, Manifest &manifest)
+{
+    QFile f(url + QDir::separator() + VCF_DIR_MANIFEST);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    // Each line: hash, tab, file name and, for record without id, tab and name key
+    while (!f.atEnd()) {
+        QList<QByteArray> fields = f.readLine().trimmed().split('\t');
+        if (fields.count()<2 || fields[0].isEmpty())
+            continue;
+        ManifestEntry entry;
+        entry.hash = fields[0];
+        entry.fileName = QString::fromUtf8(fields[1]);
+        if (fields.count()>2)
+            entry.nameKey = fields[2];
+        manifest << entry;
     }
+    f.close();
     return true;
 }
+
+bool VCFDirectory::writeManifest(const QString &url, const ContactList &list,
+    const QStringList &fileNames, const QVector<QByteArray> &hashes)
+{
+    OutputSink sink;
+    if (!sink.open(url + QDir::separator() + VCF_DIR_MANIFEST))
+        return false;
+    for (int i=0; i<fileNames.count(); i++) {
+        QByteArray line = hashes[i] + '\t' + fileNames[i].toUtf8();
+        if (list[i].id.isEmpty())
+            line += '\t' + recordNameKey(list[i]);
+        sink.writeRaw(line + '\n');
+    }
+    return sink.commit();
+}
@@ -14,8 +14,13 @@
 #ifndef VCFDIR_H
 #define VCFDIR_H
 
+#include <QHash>
+#include <QSet>
+#include <QVector>
 #include "fileformat.h"
 
+class VCardData;
+
 class VCFDirectory : public FileFormat
 {
 public:
@@ -26,6 +31,27 @@ public:
 public:
     bool importRecords(const QString &url, ContactList &list, bool append);
     bool exportRecords(const QString &url, ContactList &list);
+    // Also used by vCard zip archive
+    static QByteArray serializeRecord(VCardData& data, const ContactItem& item, QStringList& errors);
+    // Unique (case-insensitive) stable names of record files
+    static QStringList recordFileNames(const ContactList& list, const QVector<QByteArray>& hashes);
+private:
+    // Previous export state. Name key (hash of names) is stored only for
+    // records without id, to keep their file names when record is edited
+    struct ManifestEntry {
+        QString fileName;
+        QByteArray hash, nameKey;
+    };
+    typedef QList<ManifestEntry> Manifest;
+    static QStringList recordFileNames(const ContactList& list, const QVector<QByteArray>& hashes,
+        const Manifest& previous);
+    static QString uniqueFileName(const QString& baseName, QSet<QString>& usedNames);
+    static QString idFileNameBase(const QString& id);
+    static QByteArray recordNameKey(const ContactItem& item);
+    static bool isLegacyFileName(const QString& name);
+    static bool readManifest(const QString& url, Manifest& manifest);
+    static bool writeManifest(const QString& url, const ContactList& list,
+        const QStringList& fileNames, const QVector<QByteArray>& hashes);
 };
 
 #endif // VCFDIR_H
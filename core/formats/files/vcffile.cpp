@@ -14,58 +14,74 @@
 #include <QStringList>
 #include <QTextStream>
 
+// Lines count, after that read lines are parsed (at nearest record end)
+#define VCF_PORTION_LINES 4096
+
 VCFFile::VCFFile()
     :FileFormat()
 {
 }
 
-bool VCFFile::detect(const QString &url)
+int VCFFile::detect(const FileSniffer &sniffer)
 {
-    QFile f(url);
-    if (!f.open(QIODevice::ReadOnly)) return false;
-    QTextStream stream(&f);
-    QString s1 = stream.readLine();
-    bool res = s1.startsWith("BEGIN:VCARD", Qt::CaseInsensitive);
-    f.close();
-    return res;
+    if (sniffer.firstLine().startsWith("BEGIN:VCARD", Qt::CaseInsensitive))
+        return FileSniffer::Sure;
+    return FileSniffer::NotDetected;
 }
 
 QStringList VCFFile::supportedExtensions()
 {
-    return (QStringList() << "vcf" << "VCF");
+    return (QStringList() << "vcf" << "VCF" << "vcf.gz" << "VCF.GZ");
 }
 
 QStringList VCFFile::supportedFilters()
 {
-    return (QStringList() << "vCard (*.vcf *.VCF)");
+    return (QStringList() << "vCard (*.vcf *.VCF *.vcf.gz)");
 }
 
 bool VCFFile::importRecords(const QString &url, ContactList &list, bool append)
 {
-    QStringList data;
-    if (!openFile(url, QIODevice::ReadOnly))
+    if (!openInput(url, supportedExtensions()))
         return false;
     _errors.clear();
-    QStringList content;
-    QTextStream stream(&file);
-    do {
-        content.push_back(stream.readLine());
-    } while (!stream.atEnd());
-    closeFile();
-    return VCardData::importRecords(content, list, append, _errors);
+    beginImport(list, append);
+    // Records are parsed by portions as soon as read, so whole file text
+    // isn't kept in memory (input may be large stream)
+    QTextStream stream(input);
+    QStringList portion;
+    int firstLine = 0;
+    // Null string means end of data; atEnd() isn't reliable for pipes
+    for (QString s=stream.readLine(); !s.isNull(); s=stream.readLine()) {
+        portion.push_back(s);
+        if (portion.count()>=VCF_PORTION_LINES && s.startsWith("END:VCARD", Qt::CaseInsensitive)) {
+            int lineCount = portion.count(); // before quoted-printable lines merge
+            importPortion(portion, firstLine, list, _errors);
+            firstLine += lineCount;
+            portion.clear();
+        }
+    }
+    importPortion(portion, firstLine, list, _errors);
+    closeInput();
+    return endImport(list, _errors);
 }
 
 bool VCFFile::exportRecords(const QString &url, ContactList &list)
 {
-    QStringList content;
-    if (!VCardData::exportRecords(content, list, _errors))
+    if (list.isEmpty())
         return false;
-    if (!openFile(url, QIODevice::WriteOnly))
+    if (!openSink(url))
         return false;
     _errors.clear();
-    QTextStream stream(&file);
-    foreach (const QString line, content)
-        stream << line << (char)13 << endl;
-    closeFile();
-    return true;
+    sink.setLineEnding(OutputSink::CRLF);
+    // Each record is written as soon as generated
+    QStringList content;
+    foreach (const ContactItem& item, list) {
+        exportRecord(content, item, _errors);
+        foreach (const QString& line, content) {
+            sink << line;
+            sink.endLine();
+        }
+        content.clear();
+    }
+    return closeSink();
 }
@@ -0,0 +1,150 @@
+/* Double Contact
+ *
+ * Module: Parallel reader of vCards, stored as separate zip archive entries
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+#include <QObject>
+#include <QRunnable>
+#include <QTextStream>
+#include <QVector>
+#include "fileformat.h"
+#include "zipvcardreader.h"
+#include "quazip.h"
+#include "quazipfile.h"
+#include "../common/vcarddata.h"
+
+// Opening archive per job re-reads central directory,
+// so small archives are read in calling thread
+#define ZIP_VCARD_MIN_JOB_ENTRIES 64
+
+struct ZipVCardEntry {
+    QString itemID;
+    unz64_file_pos pos; // in central directory, saved by the single directory walk
+};
+
+// Inflates and parses entries [from, to)
+class ZipVCardJob : public QRunnable
+{
+public:
+    ZipVCardJob(const QString& url, const QVector<ZipVCardEntry>& entries, int from, int to)
+        :url(url), entries(entries), from(from), to(to)
+    {
+        setAutoDelete(false);
+    }
+    void run();
+    ContactList items;
+    QStringList errors;
+    QString fatalError;
+private:
+    QString url;
+    const QVector<ZipVCardEntry>& entries;
+    int from, to;
+};
+
+void ZipVCardJob::run()
+{
+    if (from>=to)
+        return;
+    QuaZip zip(url);
+    // goToFirstFile() is needed, because QuaZipFile requires current file set by QuaZip
+    if (!zip.open(QuaZip::mdUnzip) || !zip.goToFirstFile()) {
+        fatalError = QObject::tr("Can't open file");
+        return;
+    }
+    VCardData parser; // VCardData keeps per-property state, so it isn't shared between jobs
+    items.reserveRecords(to-from);
+    for (int i=from; i<to; i++) {
+        const ZipVCardEntry& entry = entries[i];
+        if (unzGoToFilePos64(zip.getUnzFile(), &entry.pos)!=UNZ_OK) {
+            errors << QObject::tr("Can't set %1 item as current in archive").arg(entry.itemID);
+            continue;
+        }
+        // Open contact pseudo-file
+        QuaZipFile vcf(&zip);
+        if (!vcf.open(QIODevice::ReadOnly)) {
+            errors << QObject::tr("Can't open %1 item in archive").arg(entry.itemID);
+            continue;
+        }
+        QByteArray data = vcf.readAll();
+        vcf.close();
+        QTextStream stream(data);
+        QStringList content;
+        while (!stream.atEnd())
+            content << stream.readLine();
+        // Append contact(s) to list!
+        parser.importRecords(content, items, true, errors);
+    }
+    zip.close();
+}
+
+ZipVCardReader::ZipVCardReader()
+    :dirFound(false), entryCount(0)
+{
+}
+
+bool ZipVCardReader::read(const QString &url, const QString &dirPath, const QString &suffix, ContactList &list)
+{
+    QuaZip zip(url);
+    if (!zip.open(QuaZip::mdUnzip)) {
+        fatalError = QObject::tr("Can't open file");
+        return false;
+    }
+    // Walk central directory once, remembering position of each contact
+    // DON'T replace / to QDir::separator(), it may not work on Windows!
+    const QString prefix = dirPath.isEmpty() ? "" : dirPath + "/";
+    dirFound = dirPath.isEmpty();
+    QVector<ZipVCardEntry> entries;
+    for (bool more=zip.goToFirstFile(); more; more=zip.goToNextFile()) {
+        const QString name = zip.getCurrentFileName();
+        if (!name.startsWith(prefix))
+            continue;
+        dirFound = true;
+        ZipVCardEntry entry;
+        entry.itemID = name.mid(prefix.length());
+        // Skip directory itself and nested directories
+        if (entry.itemID.isEmpty() || entry.itemID.contains('/'))
+            continue;
+        if (!suffix.isEmpty() && !entry.itemID.endsWith(suffix, Qt::CaseInsensitive))
+            continue;
+        if (unzGetFilePos64(zip.getUnzFile(), &entry.pos)!=UNZ_OK) {
+            errors << QObject::tr("Can't set %1 item as current in archive").arg(entry.itemID);
+            continue;
+        }
+        entries << entry;
+    }
+    zip.close();
+    entryCount = entries.count();
+    const int chunk = FileFormat::jobChunkSize(entries.count(), ZIP_VCARD_MIN_JOB_ENTRIES);
+    QList<ZipVCardJob*> jobs;
+    for (int from=0; from<entries.count(); from+=chunk)
+        jobs << new ZipVCardJob(url, entries, from, qMin(from+chunk, entries.count()));
+    FileFormat::runJobs(jobs);
+    // Failed job would silently drop its whole chunk, so nothing is merged
+    foreach (ZipVCardJob* job, jobs) {
+        errors << job->errors;
+        if (fatalError.isEmpty() && !job->fatalError.isEmpty())
+            fatalError = job->fatalError;
+    }
+    if (!fatalError.isEmpty()) {
+        qDeleteAll(jobs);
+        return false;
+    }
+    // Merge in entry order; single job result is shared, not copied
+    if (jobs.count()==1)
+        list.appendRecords(jobs.first()->items);
+    else {
+        list.reserveRecords(entries.count());
+        foreach (ZipVCardJob* job, jobs)
+            foreach (const ContactItem& item, job->items)
+                list.push_back(item);
+    }
+    qDeleteAll(jobs);
+    return true;
+}
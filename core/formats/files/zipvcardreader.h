@@ -0,0 +1,36 @@
+/* Double Contact
+ *
+ * Module: Parallel reader of vCards, stored as separate zip archive entries
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef ZIPVCARDREADER_H
+#define ZIPVCARDREADER_H
+
+#include <QStringList>
+#include "contactlist.h"
+
+// Used by NBF backup and vCard archive formats.
+// Central directory is walked once; entries are inflated and parsed
+// by jobs, each with its own archive handle, and merged in entry order
+class ZipVCardReader
+{
+public:
+    ZipVCardReader();
+    // Appends records from entries in dirPath (archive root, if empty; not recursive).
+    // If suffix isn't empty, only entries with this suffix are read
+    bool read(const QString& url, const QString& dirPath, const QString& suffix, ContactList& list);
+    QStringList errors;
+    QString fatalError;
+    bool dirFound; // dirPath exists in archive
+    int entryCount;
+};
+
+#endif // ZIPVCARDREADER_H
@@ -3,10 +3,15 @@
 #include <QObject>
 
 #include "files/csvfile.h"
+#include "files/dcbfile.h"
+#include "files/filesniffer.h"
 #include "files/htmlfile.h"
+#include "files/jcardfile.h"
+#include "files/ldiffile.h"
 #include "files/mpbfile.h"
 #include "files/nbffile.h"
 #include "files/udxfile.h"
+#include "files/vcfarchive.h"
 #include "files/vcffile.h"
 
 FormatFactory::FormatFactory()
@@ -32,12 +37,16 @@ QStringList FormatFactory::supportedFilters(QIODevice::OpenMode mode, bool isRep
 #warning MPB save and load will not work under Qt earlier than 4.8
 #endif
         allSupported += "*." + CSVFile::supportedExtensions().join(" *.");
+        allSupported += "*." + DCBFile::supportedExtensions().join(" *.");
+        allSupported += "*." + LDIFFile::supportedExtensions().join(" *.");
+        allSupported += "*." + JCardFile::supportedExtensions().join(" *.");
         if (mode==QIODevice::ReadOnly) {
             // ...here add read-only formats
             allSupported += "*." + NBFFile::supportedExtensions().join(" *.");
         }
         else { // Write-only formats
         }
+        allSupported += "*." + VCFArchive::supportedExtensions().join(" *.");
         // ...here add supportedExtensions() for new format
         allTypes << S_ALL_SUPPORTED.arg(allSupported);
         // Known formats (separate)
@@ -47,20 +56,25 @@ QStringList FormatFactory::supportedFilters(QIODevice::OpenMode mode, bool isRep
         allTypes << MPBFile::supportedFilters();
 #endif
         allTypes << CSVFile::supportedFilters();
+        allTypes << DCBFile::supportedFilters();
+        allTypes << LDIFFile::supportedFilters();
+        allTypes << JCardFile::supportedFilters();
         if (mode==QIODevice::ReadOnly) {
             // ...here add filters for read-only formats
             allTypes << NBFFile::supportedFilters();
         }
         else { // Write-only formats
         }
+        allTypes << VCFArchive::supportedFilters();
         // ...here add supportedFilters() for new format
     }
     allTypes << S_ALL_FILES;
     return allTypes;
 }
 
-IFormat *FormatFactory::createObject(const QString &url)
+IFormat *FormatFactory::createObject(const QString &url, QIODevice::OpenMode mode)
 {
+    formatName.clear();
     if (url.isEmpty()) {
         error = QObject::tr("Empty file name");
         return 0;
@@ -69,35 +83,103 @@ IFormat *FormatFactory::createObject(const QString &url)
     QString ext = info.completeSuffix();
     // Known formats by extension
     if (VCFFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
-        return new VCFFile();
-    if (UDXFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
-        return new UDXFile();
-    if (CSVFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
-        return new CSVFile();
-    if (NBFFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
-        return new NBFFile();
+        formatName = "vcf";
+    else if (UDXFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "udx";
+    else if (CSVFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "csv";
+    else if (NBFFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "nbf";
 #if QT_VERSION >= 0x040800
-    if (MPBFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
-        return new MPBFile();
+    else if (MPBFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "mpb";
 #endif
-    if (HTMLFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
-        return new HTMLFile();
+    else if (HTMLFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "html";
+    else if (DCBFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "dcb";
+    else if (LDIFFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "ldif";
+    else if (JCardFile::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = "jcard";
+    // Zip may contain single vCard or CSV file, so archive is sniffed on read;
+    // on write, it's always vCard archive
+    else if (VCFArchive::supportedExtensions().contains(ext, Qt::CaseInsensitive))
+        formatName = (mode==QIODevice::ReadOnly && info.exists()) ? detectFormat(url) : QString("vcfzip");
     // ...here add supportedExtensions() for new format
+    else if (mode==QIODevice::ReadOnly)
+        formatName = detectFormat(url);
+    if (formatName.isEmpty()) {
+        // Sad but true
+        error = QObject::tr("Unknown file format:\n%1").arg(url);
+        return 0;
+    }
+    return createByName(formatName);
+}
+
+QString FormatFactory::detectFormat(const QString &url)
+{
     // Known formats with non-standard extension
-    if (VCFFile::detect(url))
+    // File is read once, then the most confident detector wins
+    // (on equal confidence, the first one)
+    FileSniffer sniffer(url);
+    if (!sniffer.isReadable)
+        return "";
+    QString bestName;
+    int bestConfidence = FileSniffer::NotDetected;
+    // Only vCard, jCard, CSV and LDIF are read from gzip and zip archives
+    bool compressed = sniffer.isGzip || sniffer.isZip;
+    if (!compressed)
+        checkConfidence(bestName, bestConfidence, "dcb", DCBFile::detect(sniffer));
+    checkConfidence(bestName, bestConfidence, "vcf", VCFFile::detect(sniffer));
+    if (!compressed)
+        checkConfidence(bestName, bestConfidence, "udx", UDXFile::detect(sniffer));
+#if QT_VERSION >= 0x040800
+    if (!compressed)
+        checkConfidence(bestName, bestConfidence, "mpb", MPBFile::detect(sniffer));
+#endif
+    checkConfidence(bestName, bestConfidence, "nbf", NBFFile::detect(sniffer));
+    // Exact, so vCard archive wins over its first entry, sniffed as vCard
+    checkConfidence(bestName, bestConfidence, "vcfzip", VCFArchive::detect(sniffer));
+    checkConfidence(bestName, bestConfidence, "ldif", LDIFFile::detect(sniffer));
+    checkConfidence(bestName, bestConfidence, "jcard", JCardFile::detect(sniffer));
+    checkConfidence(bestName, bestConfidence, "csv", CSVFile::detect(sniffer));
+    // ...here add detect() for new format
+    return bestName;
+}
+
+IFormat *FormatFactory::createByName(const QString &name)
+{
+    if (name=="vcf")
         return new VCFFile();
-    if (UDXFile::detect(url))
+    if (name=="udx")
         return new UDXFile();
+    if (name=="csv")
+        return new CSVFile();
+    if (name=="nbf")
+        return new NBFFile();
 #if QT_VERSION >= 0x040800
-    if (MPBFile::detect(url))
+    if (name=="mpb")
         return new MPBFile();
 #endif
-    if (NBFFile::detect(url))
-        return new NBFFile();
-    if (CSVFile::detect(url))
-        return new CSVFile();
-    // ...here add detect() for new format
-    // Sad but true
-    error = QObject::tr("Unknown file format:\n%1").arg(url);
+    if (name=="html")
+        return new HTMLFile();
+    if (name=="dcb")
+        return new DCBFile();
+    if (name=="jcard")
+        return new JCardFile();
+    if (name=="ldif")
+        return new LDIFFile();
+    if (name=="vcfzip")
+        return new VCFArchive();
+    // ...here add new format
     return 0;
 }
+
+void FormatFactory::checkConfidence(QString &bestName, int &bestConfidence, const QString &name, int confidence)
+{
+    if (confidence>bestConfidence) {
+        bestName = name;
+        bestConfidence = confidence;
+    }
+}
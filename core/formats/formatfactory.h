@@ -22,8 +22,14 @@ class FormatFactory
 public:
     FormatFactory();
     static QStringList supportedFilters(QIODevice::OpenMode mode, bool isReportFormat);
-    IFormat* createObject(const QString& url);
+    // Write target is chosen only by extension, existing file isn't sniffed
+    IFormat* createObject(const QString& url, QIODevice::OpenMode mode = QIODevice::ReadOnly);
+    static QString detectFormat(const QString& url); // by content; empty if unknown
+    static IFormat* createByName(const QString& name);
     QString error;
+    QString formatName; // vcf, udx, csv, nbf, mpb, html, dcb; set by createObject()
+private:
+    static void checkConfidence(QString& bestName, int& bestConfidence, const QString& name, int confidence);
 };
 
 #endif // FORMATFACTORY_H
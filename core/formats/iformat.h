@@ -34,7 +34,7 @@ public:
     virtual QStringList errors()=0;
     virtual QString fatalError()=0;
     /* Subclasses also can create next _static_ methods:
-     * bool detect(const QString& url); // tri-state?
+     * int detect(const FileSniffer& sniffer); // FileSniffer::Confidence
      * QStringList supportedExtensions(); // only for files
      * QStringList supportedFilters();    // only for files
      */
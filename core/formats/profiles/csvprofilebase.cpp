@@ -27,6 +27,11 @@ QString CSVProfileBase::charSet() const
     return _charSet;
 }
 
+QChar CSVProfileBase::separator() const
+{
+    return _separator;
+}
+
 bool CSVProfileBase::hasBOM() const
 {
     return _hasBOM;
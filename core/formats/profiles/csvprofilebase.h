@@ -38,6 +38,7 @@ public:
     QString name() const;
     bool hasHeader() const;
     QString charSet() const;
+    QChar separator() const;
     bool hasBOM() const; // only if charset is UTF*
     QuotingPolicy quotingPolicy() const;
     LineEnding lineEnding() const;
@@ -51,6 +52,7 @@ public:
 protected:
     // Profile properties
     QString _name, _charSet;
+    QChar _separator;
     bool _hasHeader, _hasBOM;
     QuotingPolicy _quotingPolicy;
     LineEnding _lineEnding;
@@ -63,6 +65,6 @@ protected:
 };
 
 // Macros for use exclusively in exportRecord(...) methods
-#define LOSS_DATA(x, y) FileFormat::lossData(errors, item.visibleName, x, y)
+#define LOSS_DATA(x, y) FileFormat::lossData(errors, item.visibleName(), x, y)
 
 #endif // CSVPROFILEBASE_H
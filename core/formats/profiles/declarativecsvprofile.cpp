@@ -0,0 +1,581 @@
+/* Double Contact
+ *
+ * Module: CSV file profile, described by data (built-in or loaded from file)
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QTextStream>
+#include "declarativecsvprofile.h"
+
+#define DEFAULT_DATE_FORMAT "yyyy-MM-dd"
+
+// Profiles from data files: directory is scanned and files are parsed
+// once per process; each CSVFile gets own copies, because parseHeader()
+// changes profile state. Mutex is needed for batch conversion jobs
+static QMutex fileProfilesMutex;
+static bool fileProfilesLoaded = false;
+static QList<DeclarativeCSVProfile> fileProfiles;
+
+DeclarativeCSVProfile::DeclarativeCSVProfile()
+    :dateFormat(DEFAULT_DATE_FORMAT), rowWidth(0), hasPositions(false), kindMask(0)
+{
+    _hasHeader = true;
+    _charSet = "UTF-8";
+    _separator = QChar(',');
+    _hasBOM = false;
+    _quotingPolicy = CSVProfileBase::QuoteIfNeed;
+    _lineEnding = CSVProfileBase::LFEnding;
+}
+
+bool DeclarativeCSVProfile::load(const QString &path, QString &error)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        error = S_READ_ERR.arg(path);
+        return false;
+    }
+    QTextStream stream(&f);
+    stream.setCodec("UTF-8");
+    QString description = stream.readAll();
+    f.close();
+    if (!loadFromString(description, error)) {
+        error = QString("%1: %2").arg(path).arg(error);
+        return false;
+    }
+    return true;
+}
+
+bool DeclarativeCSVProfile::loadFromString(const QString &description, QString &error)
+{
+    columns.clear();
+    detectColumns.clear();
+    kindMask = 0;
+    hasPositions = false;
+    QStringList lines = description.split("\n");
+    for (int i=0; i<lines.count(); i++) {
+        QString line = lines[i].trimmed();
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+        int eqPos = line.indexOf("=");
+        if (eqPos==-1) {
+            error = QObject::tr("Line %1: '=' expected").arg(i+1);
+            return false;
+        }
+        QString key = line.left(eqPos).trimmed().toLower();
+        QString val = line.mid(eqPos+1).trimmed();
+        if (key=="name")
+            _name = val;
+        else if (key=="charset")
+            _charSet = val;
+        else if (key=="separator") {
+            if (val.toLower()=="tab")
+                _separator = QChar('\t');
+            else if (val.length()==1)
+                _separator = val.at(0);
+            else {
+                error = QObject::tr("Line %1: separator must be one character or 'tab'").arg(i+1);
+                return false;
+            }
+        }
+        else if (key=="bom")
+            _hasBOM = (val.toLower()=="yes");
+        else if (key=="header")
+            _hasHeader = (val.toLower()=="yes");
+        else if (key=="quoting") {
+            if (val.toLower()=="never")
+                _quotingPolicy = CSVProfileBase::NeverQuote;
+            else if (val.toLower()=="always")
+                _quotingPolicy = CSVProfileBase::AlwaysQuote;
+            else
+                _quotingPolicy = CSVProfileBase::QuoteIfNeed;
+        }
+        else if (key=="lineending")
+            _lineEnding = (val.toLower()=="crlf") ? CSVProfileBase::CRLFEnding : CSVProfileBase::LFEnding;
+        else if (key=="dateformat")
+            dateFormat = val;
+        else if (key=="detect")
+            detectColumns = val.split("|");
+        else if (key=="column") {
+            Column col;
+            if (!parseColumn(val, col)) {
+                error = QObject::tr("Line %1: bad column description: %2").arg(i+1).arg(val);
+                return false;
+            }
+            columns << col;
+            kindMask |= (1 << col.kind);
+        }
+        else {
+            error = QObject::tr("Line %1: unknown key: %2").arg(i+1).arg(key);
+            return false;
+        }
+    }
+    if (_name.isEmpty()) {
+        error = QObject::tr("Profile name is missing");
+        return false;
+    }
+    if (columns.isEmpty()) {
+        error = QObject::tr("Profile has no columns");
+        return false;
+    }
+    // Column without explicit position is at its place in description
+    positionIndexes.resize(columns.count());
+    rowWidth = 0;
+    for (int i=0; i<columns.count(); i++) {
+        positionIndexes[i] = (columns[i].position==-1) ? i : columns[i].position;
+        rowWidth = qMax(rowWidth, positionIndexes[i]+1);
+    }
+    for (int i=0; i<columns.count(); i++)
+        if (positionIndexes.indexOf(positionIndexes[i])!=i) {
+            error = QObject::tr("Column %1 has the same position as another column").arg(columns[i].name);
+            return false;
+        }
+    // Without header, columns are always read by position
+    columnIndexes = positionIndexes;
+    return true;
+}
+
+QList<DeclarativeCSVProfile*> DeclarativeCSVProfile::createFileProfiles()
+{
+    QMutexLocker locker(&fileProfilesMutex);
+    if (!fileProfilesLoaded) {
+        QDir dir(profilesPath());
+        foreach (const QString& fileName, dir.entryList(QStringList() << "*.csvprofile", QDir::Files, QDir::Name)) {
+            DeclarativeCSVProfile profile;
+            QString error;
+            if (profile.load(dir.filePath(fileName), error))
+                fileProfiles << profile;
+            else
+                qWarning("%s", error.toLocal8Bit().data());
+        }
+        fileProfilesLoaded = true;
+    }
+    QList<DeclarativeCSVProfile*> res;
+    foreach (const DeclarativeCSVProfile& profile, fileProfiles)
+        res << new DeclarativeCSVProfile(profile);
+    return res;
+}
+
+QString DeclarativeCSVProfile::profilesPath()
+{
+#ifdef WIN32
+    return qApp->applicationDirPath() + "/csvprofiles";
+#else
+    if (QDir("/usr/share/doublecontact/csvprofiles").exists())
+        // Standard case
+        return "/usr/share/doublecontact/csvprofiles";
+    else
+        // Developer case
+        return qApp->applicationDirPath() + "/csvprofiles";
+#endif
+}
+
+bool DeclarativeCSVProfile::detect(const QStringList &header) const
+{
+    if (!detectColumns.isEmpty()) {
+        foreach (const QString& col, detectColumns)
+            if (!header.contains(col))
+                return false;
+        return true;
+    }
+    // By default, first columns must be as in description
+    for (int i=0; i<columns.count() && i<3; i++)
+        if (header.value(positionIndexes[i])!=columns[i].name)
+            return false;
+    return true;
+}
+
+bool DeclarativeCSVProfile::parseHeader(const QStringList &header)
+{
+    if (!_hasHeader)
+        return true;
+    // Name lookup is done once per file; rows are read by integer indexes
+    QHash<QString, int> fileColumns;
+    fileColumns.reserve(header.count());
+    for (int i=header.count()-1; i>=0; i--)
+        fileColumns[header[i]] = i;
+    // Columns with explicit position are read by it even with header
+    for (int i=0; i<columns.count(); i++)
+        columnIndexes[i] = (columns[i].position==-1)
+            ? fileColumns.value(columns[i].name, -1) : columns[i].position;
+    return !header.isEmpty();
+}
+
+int DeclarativeCSVProfile::columnByName(const QString &name) const
+{
+    for (int i=0; i<columns.count(); i++)
+        if (columns[i].name==name)
+            return i;
+    return -1;
+}
+
+QString DeclarativeCSVProfile::value(const QStringList &row, int column) const
+{
+    if (column<0 || column>=columnIndexes.count())
+        return "";
+    int index = columnIndexes[column];
+    if (index<0 || index>=row.count())
+        return "";
+    return row[index];
+}
+
+bool DeclarativeCSVProfile::importRecord(const QStringList &row, ContactItem &item, QStringList &errors)
+{
+    int firstAddr = item.addrs.count();
+    bool hasNames = false;
+    for (int i=0; i<columns.count(); i++) {
+        const Column& col = columns[i];
+        int index = columnIndexes[i];
+        if (index<0 || index>=row.count() || row[index].isEmpty())
+            continue;
+        const QString& val = row[index];
+        switch (col.kind) {
+        case fkSkip:
+            break;
+        case fkWarning:
+            readWarning(row, index, errors);
+            break;
+        case fkFullName:
+            item.fullName = val;
+            break;
+        case fkNames:
+            while (item.names.count()<=col.part)
+                item.names << "";
+            item.names[col.part] = val;
+            hasNames = true;
+            break;
+        case fkNickName:
+            item.nickName = val;
+            break;
+        case fkSortString:
+            item.sortString = val;
+            break;
+        case fkBirthday:
+            item.birthday = DateItem(QDateTime::fromString(val, dateFormat));
+            break;
+        case fkAnniversary:
+            item.anniversaries << DateItem(QDateTime::fromString(val, dateFormat));
+            break;
+        case fkOrganization:
+            item.organization = val;
+            break;
+        case fkTitle:
+            item.title = val;
+            break;
+        case fkDescription:
+            item.description = val;
+            break;
+        case fkUrl:
+            item.url = val;
+            break;
+        case fkId:
+            item.id = val;
+            break;
+        case fkPhone:
+            item.phones << Phone(val, col.param.isEmpty() ? QString("pref") : col.param);
+            break;
+        case fkEmail:
+            item.emails << Email(val, col.param.isEmpty() ? QString("pref") : col.param);
+            break;
+        case fkIM:
+            item.ims << Messenger(val, col.param);
+            break;
+        case fkAddress: {
+            // Parts of one address are in different columns
+            int a = firstAddr;
+            while (a<item.addrs.count() && !item.addrs[a].types.contains(col.param, Qt::CaseInsensitive))
+                a++;
+            if (a==item.addrs.count()) {
+                PostalAddress addr;
+                addr.types << col.param;
+                item.addrs << addr;
+            }
+            setAddressPart(item.addrs[a], col.part, val);
+            break;
+        }
+        case fkTag:
+            item.unknownTags << TagValue(col.param, val);
+            break;
+        }
+    }
+    if (hasNames)
+        item.dropFinalEmptyNames();
+    return true;
+}
+
+QStringList DeclarativeCSVProfile::makeHeader()
+{
+    QStringList header;
+    foreach (const Column& col, columns)
+        header << col.name;
+    return placeByPositions(header);
+}
+
+QStringList DeclarativeCSVProfile::placeByPositions(const QStringList &row) const
+{
+    if (!hasPositions)
+        return row;
+    // Cells between positioned columns are left empty
+    QStringList res;
+    for (int i=0; i<rowWidth; i++)
+        res << QString();
+    for (int i=0; i<row.count() && i<positionIndexes.count(); i++)
+        res[positionIndexes[i]] = row[i];
+    return res;
+}
+
+template<class T>
+QString DeclarativeCSVProfile::takeTyped(const QList<T> &values, QVector<bool> &used, const QString &type) const
+{
+    for (int i=0; i<values.count(); i++)
+        if (!used[i] && (type.isEmpty() || values[i].types.contains(type, Qt::CaseInsensitive))) {
+            used[i] = true;
+            return values[i].value;
+        }
+    return "";
+}
+
+bool DeclarativeCSVProfile::exportRecord(QStringList &row, const ContactItem &item, QStringList &errors)
+{
+    const int firstCell = row.count();
+    QVector<bool> usedPhones(item.phones.count(), false);
+    QVector<bool> usedEmails(item.emails.count(), false);
+    QVector<bool> usedIMs(item.ims.count(), false);
+    QVector<bool> usedAddrs(item.addrs.count(), false);
+    foreach (const Column& col, columns) {
+        switch (col.kind) {
+        case fkFullName:
+            row << item.fullName;
+            break;
+        case fkNames:
+            row << saveNamePart(item, col.part);
+            break;
+        case fkNickName:
+            row << item.nickName;
+            break;
+        case fkSortString:
+            row << item.sortString;
+            break;
+        case fkBirthday:
+            row << item.birthday.value.toString(dateFormat);
+            break;
+        case fkAnniversary:
+            row << (item.anniversaries.isEmpty() ? QString() : item.anniversaries[0].value.toString(dateFormat));
+            break;
+        case fkOrganization:
+            row << item.organization;
+            break;
+        case fkTitle:
+            row << item.title;
+            break;
+        case fkDescription:
+            row << item.description;
+            break;
+        case fkUrl:
+            row << item.url;
+            break;
+        case fkId:
+            row << item.id;
+            break;
+        case fkPhone:
+            row << takeTyped(item.phones, usedPhones, col.param);
+            break;
+        case fkEmail:
+            row << takeTyped(item.emails, usedEmails, col.param);
+            break;
+        case fkIM:
+            row << takeTyped(item.ims, usedIMs, col.param);
+            break;
+        case fkAddress: {
+            QString val;
+            for (int i=0; i<item.addrs.count(); i++)
+                if (item.addrs[i].types.contains(col.param, Qt::CaseInsensitive)) {
+                    val = addressPart(item.addrs[i], col.part);
+                    usedAddrs[i] = true;
+                    break;
+                }
+            row << val;
+            break;
+        }
+        case fkTag: {
+            QString val;
+            foreach (const TagValue& tag, item.unknownTags)
+                if (tag.tag==col.param) {
+                    val = tag.value;
+                    break;
+                }
+            row << val;
+            break;
+        }
+        default: // fkSkip, fkWarning
+            row << "";
+            break;
+        }
+    }
+    LOSS_DATA(S_SOME_PHONES, usedPhones.contains(false));
+    LOSS_DATA(S_SOME_EMAILS, usedEmails.contains(false));
+    FileFormat::lossData(errors, item.visibleName(), S_IM, usedIMs.contains(false));
+    LOSS_DATA(S_ADDR, usedAddrs.contains(false));
+    LOSS_DATA(S_BDAY, !hasKind(fkBirthday) && !item.birthday.isEmpty());
+    LOSS_DATA(S_ANN, (!hasKind(fkAnniversary) && !item.anniversaries.isEmpty()) || item.anniversaries.count()>1);
+    LOSS_DATA(S_DESC, !hasKind(fkDescription) && !item.description.isEmpty());
+    LOSS_DATA(S_PHOTO, !item.photo.isEmpty());
+    LOSS_DATA(S_ORG, !hasKind(fkOrganization) && !item.organization.isEmpty());
+    LOSS_DATA(S_TITLE, !hasKind(fkTitle) && !item.title.isEmpty());
+    LOSS_DATA(S_NICK, !hasKind(fkNickName) && !item.nickName.isEmpty());
+    LOSS_DATA(S_URL, !hasKind(fkUrl) && !item.url.isEmpty());
+    if (hasPositions) {
+        QStringList cells = placeByPositions(row.mid(firstCell));
+        row = row.mid(0, firstCell) + cells;
+    }
+    return true;
+}
+
+bool DeclarativeCSVProfile::parseColumn(const QString &spec, Column &col)
+{
+    // name|field[:param[:part]][|position], position is file column number from 1
+    QStringList parts = spec.split("|");
+    if (parts.count()<2)
+        return false;
+    col.position = -1;
+    if (parts.count()>2) {
+        bool ok;
+        int position = parts.last().trimmed().toInt(&ok);
+        if (ok) {
+            if (position<1)
+                return false;
+            col.position = position-1;
+            hasPositions = true;
+            parts.removeLast();
+        }
+    }
+    QStringList field = parts.takeLast().trimmed().split(":");
+    col.name = parts.join("|");
+    QString kind = field[0].toLower();
+    col.part = 0;
+    col.param = field.value(1);
+    if (kind=="skip")
+        col.kind = fkSkip;
+    else if (kind=="warning")
+        col.kind = fkWarning;
+    else if (kind=="fullname")
+        col.kind = fkFullName;
+    else if (kind=="names") {
+        col.kind = fkNames;
+        bool ok;
+        col.part = col.param.toInt(&ok);
+        if (!ok || col.part<0 || col.part>4)
+            return false;
+    }
+    else if (kind=="nickname")
+        col.kind = fkNickName;
+    else if (kind=="sortstring")
+        col.kind = fkSortString;
+    else if (kind=="bday")
+        col.kind = fkBirthday;
+    else if (kind=="anniversary")
+        col.kind = fkAnniversary;
+    else if (kind=="org")
+        col.kind = fkOrganization;
+    else if (kind=="title")
+        col.kind = fkTitle;
+    else if (kind=="note")
+        col.kind = fkDescription;
+    else if (kind=="url")
+        col.kind = fkUrl;
+    else if (kind=="id")
+        col.kind = fkId;
+    else if (kind=="phone")
+        col.kind = fkPhone;
+    else if (kind=="email")
+        col.kind = fkEmail;
+    else if (kind=="im")
+        col.kind = fkIM;
+    else if (kind=="adr") {
+        col.kind = fkAddress;
+        QString part = field.value(2).toLower();
+        if (part=="pobox")
+            col.part = apOfficeBox;
+        else if (part=="ext")
+            col.part = apExtended;
+        else if (part=="street")
+            col.part = apStreet;
+        else if (part=="city")
+            col.part = apCity;
+        else if (part=="region")
+            col.part = apRegion;
+        else if (part=="postcode")
+            col.part = apPostalCode;
+        else if (part=="country")
+            col.part = apCountry;
+        else
+            return false;
+    }
+    else if (kind=="tag") {
+        col.kind = fkTag;
+        if (col.param.isEmpty())
+            return false;
+    }
+    else
+        return false;
+    return true;
+}
+
+QString DeclarativeCSVProfile::addressPart(const PostalAddress &addr, int part) const
+{
+    switch (part) {
+    case apOfficeBox:
+        return addr.offBox;
+    case apExtended:
+        return addr.extended;
+    case apStreet:
+        return addr.street;
+    case apCity:
+        return addr.city;
+    case apRegion:
+        return addr.region;
+    case apPostalCode:
+        return addr.postalCode;
+    default:
+        return addr.country;
+    }
+}
+
+void DeclarativeCSVProfile::setAddressPart(PostalAddress &addr, int part, const QString &value) const
+{
+    switch (part) {
+    case apOfficeBox:
+        addr.offBox = value;
+        break;
+    case apExtended:
+        addr.extended = value;
+        break;
+    case apStreet:
+        addr.street = value;
+        break;
+    case apCity:
+        addr.city = value;
+        break;
+    case apRegion:
+        addr.region = value;
+        break;
+    case apPostalCode:
+        addr.postalCode = value;
+        break;
+    default:
+        addr.country = value;
+        break;
+    }
+}
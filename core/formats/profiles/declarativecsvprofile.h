@@ -0,0 +1,79 @@
+/* Double Contact
+ *
+ * Module: CSV file profile, described by data (built-in or loaded from file)
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#ifndef DECLARATIVECSVPROFILE_H
+#define DECLARATIVECSVPROFILE_H
+
+#include <QVector>
+#include "csvprofilebase.h"
+
+// Profile description format: see doc/csvprofiles.en.md
+class DeclarativeCSVProfile : public CSVProfileBase
+{
+public:
+    DeclarativeCSVProfile();
+    bool load(const QString& path, QString& error);
+    bool loadFromString(const QString& description, QString& error);
+    static QString profilesPath(); // directory with *.csvprofile files
+    // New copies of profiles from profilesPath(), loaded on first call
+    static QList<DeclarativeCSVProfile*> createFileProfiles();
+    virtual bool detect(const QStringList& header) const;
+    // Read
+    virtual bool parseHeader(const QStringList& header);
+    virtual bool importRecord(const QStringList& row, ContactItem& item, QStringList& errors);
+    // Write
+    virtual QStringList makeHeader();
+    virtual bool exportRecord(QStringList& row, const ContactItem& item, QStringList& errors);
+protected:
+    enum FieldKind {
+        fkSkip,
+        fkWarning, // unsupported, but must be empty
+        fkFullName, fkNames, fkNickName, fkSortString,
+        fkBirthday, fkAnniversary,
+        fkOrganization, fkTitle, fkDescription, fkUrl, fkId,
+        fkPhone, fkEmail, fkIM, fkAddress,
+        fkTag // unknown tag
+    };
+    enum AddressPart {
+        apOfficeBox, apExtended, apStreet, apCity, apRegion, apPostalCode, apCountry
+    };
+    struct Column {
+        QString name; // in header
+        FieldKind kind;
+        int part;     // name index or AddressPart
+        QString param; // phone/email/IM/address type or tag name
+        int position;  // explicit file column (0-based), or -1
+    };
+    QVector<Column> columns;
+    // Description column (not file column!) by header name, or -1
+    int columnByName(const QString& name) const;
+    // Value of description column in current row; empty for column -1
+    QString value(const QStringList& row, int column) const;
+private:
+    QStringList detectColumns;
+    QString dateFormat;
+    QVector<int> columnIndexes; // file column for each description column; built by parseHeader
+    QVector<int> positionIndexes; // file column by position: explicit or description order
+    int rowWidth; // file columns count, on write
+    bool hasPositions; // some columns have explicit position
+    int kindMask; // FieldKind flags for present columns
+    bool parseColumn(const QString& spec, Column& col);
+    QStringList placeByPositions(const QStringList& row) const;
+    inline bool hasKind(FieldKind kind) const { return kindMask & (1 << kind); }
+    template<class T>
+    QString takeTyped(const QList<T>& values, QVector<bool>& used, const QString& type) const;
+    QString addressPart(const PostalAddress& addr, int part) const;
+    void setAddressPart(PostalAddress& addr, int part, const QString& value) const;
+};
+
+#endif // DECLARATIVECSVPROFILE_H
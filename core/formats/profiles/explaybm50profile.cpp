@@ -18,6 +18,7 @@ ExplayBM50Profile::ExplayBM50Profile()
     _name = "Explay BM50";
     _hasHeader = true;
     _charSet = "UTF-16LE";
+    _separator = QChar(',');
     _hasBOM = true;
     _quotingPolicy = CSVProfileBase::AlwaysQuote;
     _lineEnding = CSVProfileBase::CRLFEnding;
@@ -102,7 +103,7 @@ bool ExplayBM50Profile::exportRecord(QStringList &row, const ContactItem &item,
     row << "" << "" << ""; // TODO SIP address, Push-to-talk, Share view
     row << item.id; // [11]
     // One phone
-    row << item.prefPhone; // [12]
+    row << item.prefPhone(); // [12]
     // TODO see other rows and check on real phone
     for (int i=13; i<54; i++)
         row << "";
@@ -118,7 +119,7 @@ bool ExplayBM50Profile::exportRecord(QStringList &row, const ContactItem &item,
     LOSS_DATA(S_ADDR, !item.addrs.isEmpty());
     LOSS_DATA(S_NICK, item.nickName);
     LOSS_DATA(S_URL, item.url);
-    FileFormat::lossData(errors, item.visibleName, S_IM, !item.ims.isEmpty());
+    FileFormat::lossData(errors, item.visibleName(), S_IM, !item.ims.isEmpty());
     return true;
 }
 
@@ -19,6 +19,7 @@ ExplayTV240Profile::ExplayTV240Profile()
     _name = "Explay TV240";
     _hasHeader = true;
     _charSet = "UTF-16LE";
+    _separator = QChar(',');
     _hasBOM = false; //TODO check on 4PDA
     _quotingPolicy = CSVProfileBase::NeverQuote; // TODO check on 4PDA
     _lineEnding = CSVProfileBase::CRLFEnding; // TODO check on 4PDA
@@ -54,7 +55,7 @@ bool ExplayTV240Profile::exportRecord(QStringList &row, const ContactItem &item,
 {
     row << saveNamePart(item, 0);
     // One phone
-    row << item.prefPhone;
+    row << item.prefPhone();
     for (int i=2; i<7; i++)
         row << "";
     LOSS_DATA(S_SOME_PHONES, item.phones.count()>1);
@@ -68,7 +69,7 @@ bool ExplayTV240Profile::exportRecord(QStringList &row, const ContactItem &item,
     LOSS_DATA(S_ADDR, !item.addrs.isEmpty());
     LOSS_DATA(S_NICK, item.nickName);
     LOSS_DATA(S_URL, item.url);
-    FileFormat::lossData(errors, item.visibleName, S_IM, !item.ims.isEmpty());
+    FileFormat::lossData(errors, item.visibleName(), S_IM, !item.ims.isEmpty());
     return true;
 }
 
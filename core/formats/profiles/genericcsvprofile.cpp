@@ -30,12 +30,13 @@ void TypeCounter::append(const TypeCounter &localCounter)
 }
 
 GenericCSVProfile::GenericCSVProfile()
-    :VCardData()
+    :VCardData(), rowNumber(0)
 {
     clearCounters();
     _name = S_GENERIC_CSV_PROFILE;
     _hasHeader = true;
     _charSet = "UTF-8";
+    _separator = QChar(',');
     // To open CSV from Anisimov's vcf2csv convertor with ; separator in LibreOffice 3.6.1.2, set ";" separator in LibreOffice import window; else N components will be splitted
     _hasBOM = false;
     _quotingPolicy = CSVProfileBase::AlwaysQuote;
@@ -52,6 +53,13 @@ bool GenericCSVProfile::detect(const QStringList &header) const
 bool GenericCSVProfile::parseHeader(const QStringList &header)
 {
     _header = header;
+    // Column properties are parsed once per file, not for each row
+    headerErrors.clear();
+    rowNumber = 0;
+    prepareImport();
+    columns.resize(header.count());
+    for (int i=0; i<header.count(); i++)
+        parseProperty(header[i], columns[i], 0, headerErrors); // header row
     return (!header.isEmpty());
 }
 
@@ -60,18 +68,20 @@ bool GenericCSVProfile::importRecord(const QStringList &row, ContactItem &item,
     if (row.count()!= _header.count())
         errors << QObject::tr("Row length (%1) is not equal header length (%2). Possibly, incorrect CSV. \n%3")
             .arg(row.count()).arg(_header.count()).arg(row.join(",")); // TODO separator instead ,
-    QStringList vCard;
-    vCard << "BEGIN:VCARD";
-    for (int i=0; (i<row.count() && i<_header.count()); i++)
+    if (!headerErrors.isEmpty()) { // report once, with first record
+        errors << headerErrors;
+        headerErrors.clear();
+    }
+    // Row is vCard record in other form, so version in it can be kept on export
+    item.originalFormat = "VCARD";
+    rowNumber++;
+    QString visName = "";
+    for (int i=0; (i<row.count() && i<columns.count()); i++)
         if (!row[i].isEmpty())
-            vCard << _header[i] + ":" + row[i];
-    vCard << "END:VCARD";
-    ContactList list;
-    bool res = VCardData::importRecords(vCard, list, false, errors);
-    if (!list.isEmpty())
-        item = list[0];
-    return res;
-
+            importValue(columns[i], row[i].split(";"), item, visName, rowNumber, errors);
+    if (!item.unknownTags.isEmpty())
+        errors << QObject::tr("%1 unknown tags found").arg(item.unknownTags.count());
+    return true;
 }
 
 bool GenericCSVProfile::prepareExport(const ContactList &list)
@@ -165,6 +175,7 @@ bool GenericCSVProfile::exportRecord(QStringList &row, const ContactItem &item,
 void GenericCSVProfile::clearCounters()
 {
     _header.clear();
+    columns.clear();
     hasVersion = hasFullNames = hasNames = false;
     phoneTypeCombinations.clear();
     emailTypeCombinations.clear();
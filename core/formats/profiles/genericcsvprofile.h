@@ -14,6 +14,7 @@
 #define GENERICCSVPROFILE_H
 
 #include <QMap>
+#include <QVector>
 #include "csvprofilebase.h"
 #include "../common/vcarddata.h"
 
@@ -44,6 +45,9 @@ private:
     TypeCounter phoneTypeCombinations, emailTypeCombinations, addrTypeCombinations, imTypeCombinations;
     TypeCounter otherTags, unknownTags;
     QStringList _header;
+    QVector<VCardProperty> columns; // parsed _header items
+    QStringList headerErrors;
+    int rowNumber; // of last imported row; header is row 0, so line in messages is rowNumber+1
     void clearCounters();
     // prepareExport helpers
     void checkStr(const QString& value, bool& found);
@@ -13,30 +13,89 @@
 #include <QObject>
 #include "osmoprofile.h"
 
+// Columns, read from Osmo files; see DeclarativeCSVProfile
+static const char* osmoDescription =
+    "Name=Osmo PIM\n"
+    "Charset=UTF-8\n"
+    "BOM=no\n"
+    "Header=yes\n"
+    "Quoting=ifneed\n"
+    "LineEnding=lf\n"
+    "DateFormat=dd.MM.yyyy\n"
+    "Column=Group|skip\n" // see importRecord()
+    "Column=First name|names:1\n"
+    "Column=Last name|names:0\n"
+    "Column=Second name|names:2\n"
+    "Column=Nickname|nickname\n"
+    "Column=Tags|tag:TAGS\n"
+    "Column=Birthday date|bday\n"
+    "Column=Name day date|anniversary\n"
+    "Column=Home address|adr:Home:street\n"
+    "Column=Home postcode|adr:Home:postcode\n"
+    "Column=Home city|adr:Home:city\n"
+    "Column=Home state|adr:Home:region\n"
+    "Column=Home country|adr:Home:country\n"
+    "Column=Organization|org\n"
+    "Column=Department|title\n"
+    "Column=Work address|adr:Work:street\n"
+    "Column=Work postcode|adr:Work:postcode\n"
+    "Column=Work city|adr:Work:city\n"
+    "Column=Work state|adr:Work:region\n"
+    "Column=Work country|adr:Work:country\n"
+    "Column=Fax|phone:fax\n"
+    "Column=Home phone|phone:home\n"
+    "Column=Home phone 2|phone:home\n"
+    "Column=Home phone 3|phone:home\n"
+    "Column=Home phone 4|phone:home\n"
+    "Column=Work phone|phone:work\n"
+    "Column=Work phone 2|phone:work\n"
+    "Column=Work phone 3|phone:work\n"
+    "Column=Work phone 4|phone:work\n"
+    "Column=Cell phone|phone:cell\n"
+    "Column=Cell phone 2|phone:cell\n"
+    "Column=Cell phone 3|phone:cell\n"
+    "Column=Cell phone 4|phone:cell\n"
+    "Column=E-Mail|email\n"
+    "Column=E-Mail 2|email\n"
+    "Column=E-Mail 3|email\n"
+    "Column=E-Mail 4|email\n"
+    "Column=WWW|url\n"
+    // TODO implement multiple urls for vCard 4.0, instead WWW2-WWW4
+    "Column=WWW 2|tag:WWW2\n"
+    "Column=WWW 3|tag:WWW3\n"
+    "Column=WWW 4|tag:WWW4\n"
+    "Column=IM Gadu-Gadu|im:gadu-gadu\n"
+    "Column=IM Yahoo|im:Yahoo\n"
+    "Column=IM MSN|im:msn\n"
+    "Column=IM ICQ|im:icq\n"
+    "Column=IM AOL|im:aim\n"
+    "Column=IM Jabber|im:xmpp\n"
+    "Column=IM Skype|im:skype\n"
+    "Column=IM Tlen|im:tlen\n"
+    "Column=Blog|tag:BLOG\n"
+    "Column=Additional info|note\n";
+
+// Names of description columns, used in code
+#define OSMO_COL_GROUP "Group"
+#define OSMO_COL_NAME_DAY "Name day date"
+
 OsmoProfile::OsmoProfile()
+    :DeclarativeCSVProfile()
 {
-    _name = "Osmo PIM";
-    _hasHeader = true;
-    _charSet = "UTF-8";
-    _hasBOM = false;
-    _quotingPolicy = CSVProfileBase::QuoteIfNeed;
-    _lineEnding = CSVProfileBase::LFEnding;
+    QString error;
+    loadFromString(QString::fromLatin1(osmoDescription), error);
+    // Found by name, so description can be reordered
+    groupColumn = columnByName(OSMO_COL_GROUP);
+    nameDayColumn = columnByName(OSMO_COL_NAME_DAY);
+    Q_ASSERT(groupColumn!=-1 && nameDayColumn!=-1);
 }
 
-
 bool OsmoProfile::detect(const QStringList &header) const
 {
     return header.contains("First name") || header.contains("Last name");
 
 }
 
-bool OsmoProfile::parseHeader(const QStringList &header)
-{
-    foreach(const QString& col, header)
-        columnIndexes[col] = header.indexOf(col);
-    return !columnIndexes.isEmpty();
-}
-
 bool OsmoProfile::importRecord(const QStringList &row, ContactItem &item, QStringList &errors)
 {
     // TODO m.b. need fatalError
@@ -44,167 +103,17 @@ bool OsmoProfile::importRecord(const QStringList &row, ContactItem &item, QStrin
         errors << S_CSV_ROW_TOO_SHORT.arg(row.join(","));
         return false;
     }
+    DeclarativeCSVProfile::importRecord(row, item, errors);
     // Group
-    if (present(row, "Group")) {
-        QString grName = value(row, "Group");
-        // TODO i18n???
-        if (grName!=QString::fromUtf8("Нет"))
-            // TODO full group support
-            item.otherTags << TagValue("CATEGORIES", row[0]);
-    }
-    // Names and dates
-    item.names << value(row, "Last name") << value(row, "First name") << value(row, "Second name");
-    item.nickName = value(row, "Nickname");
-    if (present(row, "Tags"))
-        item.unknownTags << TagValue("TAGS", value(row, "Tags"));
+    QString grName = value(row, groupColumn);
+    // TODO i18n???
+    if (!grName.isEmpty() && grName!=QString::fromUtf8("Нет"))
+        // TODO full group support
+        item.otherTags << TagValue("CATEGORIES", grName);
     // TODO check on invalid date
-    item.birthday = QDateTime::fromString(value(row, "Birthday date"), "dd.mm.yyyy");
-    if (present(row, "Name day date")) {
-        item.anniversaries << QDateTime::fromString(value(row, "Name day date"), "dd.mm.yyyy");
+    if (!value(row, nameDayColumn).isEmpty())
         errors << QObject::tr("Name day loaded as anniversary");
-    }
-    // Home address
-    if (present(row, "Home address") || present(row, "Home postcode")
-    || present(row, "Home city") || present(row, "Home state")
-    || present(row, "Home country"))
-    {
-        PostalAddress addr;
-        addr.types << "Home";
-        addr.street = value(row, "Home address");
-        addr.postalCode = value(row, "Home postcode");
-        addr.city = value(row, "Home city");
-        addr.region = value(row, "Home state");
-        addr.country = value(row, "Home country");
-        item.addrs << addr;
-    }
-    // Work
-    item.organization = value(row, "Organization");
-    item.title = value(row, "Department");
     if (!item.title.isEmpty())
         errors << QObject::tr("Department loaded as Job title");
-    // Work address
-    if (present(row, "Work address") || present(row, "Work postcode")
-    || present(row, "Work city") || present(row, "Work state")
-    || present(row, "Work country"))
-    {
-        PostalAddress addr;
-        addr.types << "Work";
-        addr.street = value(row, "Work address");
-        addr.postalCode = value(row, "Work postcode");
-        addr.city = value(row, "Work city");
-        addr.region = value(row, "Work state");
-        addr.country = value(row, "Work country");
-        item.addrs << addr;
-    }
-    // Phones/fax
-    if (present(row, "Fax"))
-        item.phones << Phone(value(row, "Fax"), "fax");
-    if (present(row, "Home phone"))
-        item.phones << Phone(value(row, "Home phone"), "home");
-    if (present(row, "Home phone 2"))
-        item.phones << Phone(value(row, "Home phone 2"), "home");
-    if (present(row, "Home phone 3"))
-        item.phones << Phone(value(row, "Home phone 3"), "home");
-    if (present(row, "Home phone 4"))
-        item.phones << Phone(value(row, "Home phone 4"), "home");
-    if (present(row, "Work phone"))
-        item.phones << Phone(value(row, "Work phone"), "work");
-    if (present(row, "Work phone 2"))
-        item.phones << Phone(value(row, "Work phone 2"), "work");
-    if (present(row, "Work phone 3"))
-        item.phones << Phone(value(row, "Work phone 3"), "work");
-    if (present(row, "Work phone 4"))
-        item.phones << Phone(value(row, "Work phone 4"), "work");
-    if (present(row, "Cell phone"))
-        item.phones << Phone(value(row, "Cell phone"), "cell");
-    if (present(row, "Cell phone 2"))
-        item.phones << Phone(value(row, "Cell phone 2"), "cell");
-    if (present(row, "Cell phone 3"))
-        item.phones << Phone(value(row, "Cell phone 3"), "cell");
-    if (present(row, "Cell phone 4"))
-        item.phones << Phone(value(row, "Cell phone 4"), "cell");
-    // E-Mail
-    if (present(row, "E-Mail"))
-        item.emails << Email(value(row, "E-Mail"), "pref");
-    if (present(row, "E-Mail 2"))
-        item.emails << Email(value(row, "E-Mail 2"), "pref");
-    if (present(row, "E-Mail 3"))
-        item.emails << Email(value(row, "E-Mail 3"), "pref");
-    if (present(row, "E-Mail 4"))
-        item.emails << Email(value(row, "E-Mail 4"), "pref");
-    // Web
-    item.url = value(row, "WWW");
-    // TODO implement multiple urls for vCard 4.0, instead WWW2-WWW4
-    if (present(row, "WWW2"))
-        item.unknownTags << TagValue("WWW2", value(row, "WWW2"));
-    if (present(row, "WWW3"))
-        item.unknownTags << TagValue("WWW3", value(row, "WWW3"));
-    if (present(row, "WWW4"))
-        item.unknownTags << TagValue("WWW4", value(row, "WWW4"));
-    // IMs
-    if (present(row, "IM Gadu-Gadu"))
-        item.ims << Messenger(value(row, "IM Gadu-Gadu"), "gadu-gadu");
-    if (present(row, "IM Yahoo"))
-        item.ims << Messenger(value(row, "IM Yahoo"), "Yahoo");
-    if (present(row, "IM MSN"))
-        item.ims << Messenger(value(row, "IM MSN"), "msn");
-    if (present(row, "IM ICQ"))
-        item.ims << Messenger(value(row, "IM ICQ"), "icq");
-    if (present(row, "IM AOL"))
-        item.ims << Messenger(value(row, "IM AOL"), "aim");
-    if (present(row, "IM Jabber"))
-        item.ims << Messenger(value(row, "IM Jabber"), "xmpp");
-    if (present(row, "IM Skype"))
-        item.ims << Messenger(value(row, "IM Skype"), "skype");
-    if (present(row, "IM Tlen"))
-        item.ims << Messenger(value(row, "IM Tlen"), "tlen");
-    if (present(row, "Blog"))
-        item.unknownTags << TagValue("BLOG", value(row, "Blog"));
-    item.description = value(row, "Additional info");
     return true;
 }
-
-bool OsmoProfile::exportRecord(QStringList &row, const ContactItem &item, QStringList &errors)
-{
-    // row << group from tag TODO QMap?
-    row << saveNamePart(item, 1);
-    row << saveNamePart(item, 0);
-    row << saveNamePart(item, 2);
-
-    return false; //==>
-}
-
-bool OsmoProfile::present(const QStringList &row, const QString &colName)
-{
-    if (columnIndexes.contains(colName))
-        return CSVProfileBase::present(row, columnIndexes[colName]);
-    else
-        return false;
-}
-
-QString OsmoProfile::value(const QStringList &row, const QString &colName)
-{
-    if (present(row, colName))
-        return row[columnIndexes[colName]];
-    else
-        return "";
-}
-
-QStringList OsmoProfile::makeHeader()
-{
-    return QStringList()
-        << "Group"
-        << "First name" << "Last name" << "Second name"
-        << "Nickname" << "Tags" << "Birthday date" << "Name day date"
-        << "Home address" << "Home postcode" << "Home city" << "Home state" << "Home country"
-        << "Organization" << "Department"
-        << "Work address" << "Work postcode" << "Work city" << "Work state" << "Work country"
-        << "Fax"
-        << "Home phone" << "Home phone 2" << "Home phone 3" << "Home phone 4"
-        << "Work phone" << "Work phone 2" << "Work phone 3" << "Work phone 4"
-        << "Cell phone" << "Cell phone 2" << "Cell phone 3" << "Cell phone 4"
-        << "E-Mail" << "E-Mail 2" << "E-Mail 3" << "E-Mail 4"
-        << "WWW" << "WWW 2" << "WWW 3" << "WWW 4"
-        << "IM Gadu-Gadu" << "IM Yahoo" << "IM MSN" << "IM ICQ" << "IM AOL"
-        << "IM Jabber" << "IM Skype" << "IM Tlen" << "Blog" << "Additional info";
-}
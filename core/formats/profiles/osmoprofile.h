@@ -13,25 +13,17 @@
 #ifndef OSMOPROFILE_H
 #define OSMOPROFILE_H
 
-#include <QMap>
-#include "csvprofilebase.h"
+#include "declarativecsvprofile.h"
 
-class OsmoProfile : public CSVProfileBase
+class OsmoProfile : public DeclarativeCSVProfile
 {
 public:
     OsmoProfile();
     virtual bool detect(const QStringList &header) const;
     // Read
-    virtual bool parseHeader(const QStringList& header);
     virtual bool importRecord(const QStringList &row, ContactItem &item, QStringList &errors);
-    // Write
-    virtual QStringList makeHeader();
-    virtual bool exportRecord(QStringList &row, const ContactItem &item, QStringList &errors);
 private:
-    QMap<QString, int> columnIndexes;
-    // Helpers
-    bool present(const QStringList &row, const QString& colName);
-    QString value(const QStringList &row, const QString& colName);
+    int groupColumn, nameDayColumn; // description columns, used in code
 };
 
 #endif // OSMOPROFILE_H
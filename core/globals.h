@@ -106,6 +106,8 @@ enum ContactColumn {
 // File ops
 #define S_ALL_SUPPORTED QObject::tr("All supported files (%1)")
 #define S_ALL_FILES QObject::tr("All files (*.*)")
+// File path, meaning standard input (for import) or standard output (for export)
+#define STD_STREAM_PATH "-"
 // Common errors
 #define S_READ_ERR QObject::tr("Can't read file\n%1")
 #define S_WRITE_ERR QObject::tr("Can't write file\n%1")
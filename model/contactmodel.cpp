@@ -95,9 +95,9 @@ QVariant ContactModel::data(const QModelIndex &index, int role) const
             case ccFirstName:   return c.names.count()>1  ? c.names[1] : QVariant();
             case ccMiddleName:  return c.names.count()>2  ? c.names[2] : QVariant();
             case ccFullName:    return c.fullName;
-            case ccGenericName: return c.visibleName; // must be calculated
-            case ccPhone:       return c.prefPhone;
-            case ccEMail:       return c.prefEmail;
+            case ccGenericName: return c.visibleName(); // calculated on first read
+            case ccPhone:       return c.prefPhone();
+            case ccEMail:       return c.prefEmail();
             case ccBDay:        return c.birthday.toString(DateItem::Local);
             case ccTitle:       return c.title;
             case ccOrg:         return c.organization;
@@ -115,7 +115,7 @@ QVariant ContactModel::data(const QModelIndex &index, int role) const
             }
             case ccNickName:    return c.nickName;
             case ccUrl:         return c.url;
-            case ccIM:          return c.prefIM;
+            case ccIM:          return c.prefIM();
             case ccIMJabber:    return c.findIMByType("xmpp");
             case ccIMICQ:       return c.findIMByType("icq");
             case ccIMSkype:     return c.findIMByType("skype");
@@ -198,7 +198,7 @@ bool ContactModel::saveAs(const QString& path, FormatType fType, QStringList &er
     IFormat* format = 0;
     switch (fType) {
     case ftFile:
-        format = factory.createObject(path);
+        format = factory.createObject(path, QIODevice::WriteOnly);
         break;
     case ftDirectory:
         format = new VCFDirectory();
@@ -308,6 +308,7 @@ void ContactModel::generateFullNames(const QModelIndexList &indices)
     foreach(QModelIndex index, indices) {
         beginEditRow(index);
         items[index.row()].fullName = items[index.row()].formatNames();
+        items[index.row()].calculateFields(ContactItem::fgName);
         endEditRow(index);
     }
     _changed = true;
@@ -318,6 +319,7 @@ void ContactModel::dropFullNames(const QModelIndexList &indices)
     foreach(QModelIndex index, indices) {
         beginEditRow(index);
         items[index.row()].fullName.clear();
+        items[index.row()].calculateFields(ContactItem::fgName);
         endEditRow(index);
     }
     _changed = true;
@@ -354,6 +356,7 @@ void ContactModel::splitNumbers(const QModelIndexList &indices)
         }
         while (item.phones.count()>1)
             item.phones.removeLast();
+        item.calculateFields(ContactItem::fgPhones);
         endInsertRows();
     }
     _changed = true;
@@ -363,8 +366,7 @@ void ContactModel::intlPhonePrefix(const QModelIndexList &indices, int countryRu
 {
     foreach(QModelIndex index, indices) {
         beginEditRow(index);
-        if (items[index.row()].intlPhonePrefix(countryRule))
-            items[index.row()].calculateFields();
+        items[index.row()].intlPhonePrefix(countryRule);
         endEditRow(index);
     }
     _changed = true;
@@ -0,0 +1,15 @@
+# DCB snapshot round trip tests (VCF -> DCB -> VCF, MPB extra data)
+
+QT       += core testlib
+QT       -= gui
+include(../../core/core.pri)
+
+TARGET = tst_dcbroundtrip
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += TESTDATA_DIR=\\\"$$PWD/../../testdata/\\\"
+
+SOURCES += tst_dcbroundtrip.cpp
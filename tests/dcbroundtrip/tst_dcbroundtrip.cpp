@@ -0,0 +1,142 @@
+/* Double Contact
+ *
+ * Module: DCB snapshot round trip tests
+ *
+ * Copyright 2016 Mikhail Y. Zvyozdochkin aka DarkHobbit <pub@zvyozdochkin.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. See COPYING file for more details.
+ *
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QtTest>
+#include "formats/files/dcbfile.h"
+#include "formats/files/vcffile.h"
+
+#if QT_VERSION >= 0x050000
+#include <QTemporaryDir>
+#endif
+
+class TestDCBRoundTrip : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void vcfToDcbToVcf();
+    void mpbExtra();
+private:
+    QString tempDir;
+    QString tempPath(const QString& name) const;
+    static QByteArray fileContent(const QString& path);
+};
+
+void TestDCBRoundTrip::initTestCase()
+{
+    // Version as in source file, so VCF output depends only on records
+    gd.useOriginalFileVersion = true;
+    gd.preferredVCFVersion = GlobalConfig::VCF30;
+#if QT_VERSION >= 0x050000
+    QTemporaryDir dir;
+    dir.setAutoRemove(false);
+    QVERIFY(dir.isValid());
+    tempDir = dir.path();
+#else
+    tempDir = QDir::tempPath() + "/tst_dcbroundtrip";
+    QVERIFY(QDir().mkpath(tempDir));
+#endif
+}
+
+void TestDCBRoundTrip::cleanupTestCase()
+{
+    QDir dir(tempDir);
+    foreach (const QString& name, dir.entryList(QDir::Files))
+        dir.remove(name);
+    QDir().rmdir(tempDir);
+}
+
+QString TestDCBRoundTrip::tempPath(const QString &name) const
+{
+    return tempDir + "/" + name;
+}
+
+QByteArray TestDCBRoundTrip::fileContent(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return f.readAll();
+}
+
+void TestDCBRoundTrip::vcfToDcbToVcf()
+{
+    ContactList source;
+    QVERIFY(VCFFile().importRecords(TESTDATA_DIR "vcard30_rfc2426.vcf", source, false));
+    QVERIFY(!source.isEmpty());
+    QVERIFY(DCBFile().exportRecords(tempPath("snapshot.dcb"), source));
+    ContactList restored;
+    DCBFile dcb;
+    QVERIFY2(dcb.importRecords(tempPath("snapshot.dcb"), restored, false), qPrintable(dcb.fatalError()));
+    QCOMPARE(restored.count(), source.count());
+    for (int i=0; i<source.count(); i++) {
+        QVERIFY(restored[i].identicalTo(source[i]));
+        QCOMPARE(restored[i].id, source[i].id);
+        QCOMPARE(restored[i].version, source[i].version);
+        QCOMPARE(restored[i].originalFormat, source[i].originalFormat);
+        QCOMPARE(restored[i].unknownTags.count(), source[i].unknownTags.count());
+    }
+    // Written vCards must be byte-identical
+    QVERIFY(VCFFile().exportRecords(tempPath("source.vcf"), source));
+    QVERIFY(VCFFile().exportRecords(tempPath("restored.vcf"), restored));
+    QByteArray sourceVCF = fileContent(tempPath("source.vcf"));
+    QVERIFY(!sourceVCF.isEmpty());
+    QCOMPARE(fileContent(tempPath("restored.vcf")), sourceVCF);
+}
+
+void TestDCBRoundTrip::mpbExtra()
+{
+    ContactList source;
+    source.push_back(ContactItem());
+    source.last().fullName = "Test";
+    source.last().names << "Test";
+    source.last().calculateFields();
+    MPBExtra& extra = source.extra;
+    extra.model = "Test model";
+    extra.timeStamp = "01.01.2016 12:00";
+    extra.editLines(MPBExtra::secOrganizer) << "organizer line";
+    extra.editLines(MPBExtra::secNotes) << "note 1" << "note 2";
+    extra.editLines(MPBExtra::secSMS) << "sms line";
+    CallInfo call;
+    call.cType = "1";
+    call.timeStamp = "01.01.2016 12:00";
+    call.duration = "10";
+    call.number = "+71234567890";
+    call.name = "Test";
+    extra.editCalls() << call;
+    QVERIFY(DCBFile().exportRecords(tempPath("extra.dcb"), source));
+    ContactList restored;
+    QVERIFY(DCBFile().importRecords(tempPath("extra.dcb"), restored, false));
+    QCOMPARE(restored.count(), 1);
+    const MPBExtra& rExtra = restored.extra;
+    QCOMPARE(rExtra.model, extra.model);
+    QCOMPARE(rExtra.timeStamp, extra.timeStamp);
+    QCOMPARE(rExtra.lines(MPBExtra::secOrganizer), extra.lines(MPBExtra::secOrganizer));
+    QCOMPARE(rExtra.lines(MPBExtra::secNotes), extra.lines(MPBExtra::secNotes));
+    QCOMPARE(rExtra.lines(MPBExtra::secSMS), extra.lines(MPBExtra::secSMS));
+    QCOMPARE(rExtra.lines(MPBExtra::secSMSArchive), extra.lines(MPBExtra::secSMSArchive));
+    QCOMPARE(rExtra.calls().count(), 1);
+    const CallInfo& rCall = rExtra.calls().first();
+    QCOMPARE(rCall.cType, call.cType);
+    QCOMPARE(rCall.timeStamp, call.timeStamp);
+    QCOMPARE(rCall.duration, call.duration);
+    QCOMPARE(rCall.number, call.number);
+    QCOMPARE(rCall.name, call.name);
+}
+
+QTEST_MAIN(TestDCBRoundTrip)
+
+#include "tst_dcbroundtrip.moc"